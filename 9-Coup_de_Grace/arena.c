@@ -0,0 +1,96 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "arena.h"
+
+//================| Arena Class Implementation |================//
+
+//Round a size up to the allocation alignment
+#define ARENA_ROUND(size) (((size) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+
+//Allocate a new arena with the given number of bytes of backing storage
+Arena* Arena_new(unsigned int size) {
+
+    //Attempt to allocate the object
+    Arena* arena;
+    if(!(arena = (Arena*)malloc(sizeof(Arena))))
+        return arena;
+
+    //And its storage (malloc's alignment is at least as strict as ours)
+    size = ARENA_ROUND(size);
+
+    if(!(arena->buffer = (uint8_t*)malloc(size))) {
+
+        free(arena);
+        return (Arena*)0;
+    }
+
+    arena->size = size;
+    arena->used = 0;
+    arena->overflow_bytes = 0;
+    arena->high_water = 0;
+    arena->overflow_resets = 0;
+    arena->overflow = (ArenaOverflow*)0;
+
+    return arena;
+}
+
+//Free the arena and everything still allocated from it
+void Arena_delete(Arena* arena) {
+
+    Arena_reset(arena);
+    free(arena->buffer);
+    free(arena);
+}
+
+//Get size bytes of memory that stay valid until the next reset
+//Returns null on failure
+void* Arena_alloc(Arena* arena, unsigned int size) {
+
+    void* memory;
+    ArenaOverflow* overflow;
+
+    size = ARENA_ROUND(size);
+
+    //The fast path: just bump the pointer
+    if(size <= arena->size - arena->used) {
+
+        memory = arena->buffer + arena->used;
+        arena->used += size;
+
+        return memory;
+    }
+
+    //Out of room, so get this one from the system and remember it so that
+    //the reset can give it back. The header is padded to keep the memory
+    //that follows it aligned
+    if(!(overflow = (ArenaOverflow*)malloc(ARENA_ROUND(sizeof(ArenaOverflow)) + size)))
+        return (void*)0;
+
+    overflow->next = arena->overflow;
+    arena->overflow = overflow;
+    arena->overflow_bytes += size;
+
+    return (uint8_t*)overflow + ARENA_ROUND(sizeof(ArenaOverflow));
+}
+
+//Release everything allocated since the last reset
+void Arena_reset(Arena* arena) {
+
+    ArenaOverflow* overflow;
+
+    if(arena->used + arena->overflow_bytes > arena->high_water)
+        arena->high_water = arena->used + arena->overflow_bytes;
+
+    if(arena->overflow)
+        arena->overflow_resets++;
+
+    while(arena->overflow) {
+
+        overflow = arena->overflow;
+        arena->overflow = overflow->next;
+        free(overflow);
+    }
+
+    arena->used = 0;
+    arena->overflow_bytes = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <inttypes.h>
+
+//================| Arena Class Declaration |================//
+
+//A bump-pointer allocator for short-lived objects. Allocating is just moving
+//a pointer forward, individual objects are never freed, and resetting the
+//arena throws everything away in one go. The window system keeps one of
+//these for the scratch lists and regions it builds while handling an event,
+//and resets it once the event is done.
+//
+//If the arena runs out of room, further allocations fall back to malloc
+//and are released by the next reset, so running out only costs speed.
+//The high-water mark records the most any one cycle ever needed (counting
+//the overflow), which is what the arena size should be tuned against
+
+//All allocations are aligned to this many bytes, which is plenty for the
+//structs we put in here
+#define ARENA_ALIGN 8
+
+typedef struct ArenaOverflow_struct {
+    struct ArenaOverflow_struct* next;
+} ArenaOverflow;
+
+typedef struct Arena_struct {
+    uint8_t* buffer;
+    unsigned int size;
+    unsigned int used;
+    unsigned int overflow_bytes; //Allocated outside the buffer since the last reset
+    unsigned int high_water;
+    unsigned int overflow_resets; //Number of cycles that didn't fit in the buffer
+    ArenaOverflow* overflow;
+} Arena;
+
+//Methods
+Arena* Arena_new(unsigned int size);
+void Arena_delete(Arena* arena);
+void* Arena_alloc(Arena* arena, unsigned int size);
+void Arena_reset(Arena* arena);
+
+#endif //ARENA_H
@@ -0,0 +1,193 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../context.h"
+
+//================| Batched Fill Microbenchmark |================//
+
+//Times painting a calculator's worth of primitives (its border, and a
+//grid of buttons each made of a fill and a few outlines) one call at a
+//time against the same calls made inside of a batch, through clip regions
+//ranging from a single rect to one cut up by lots of windows lying over it.
+//Batches are timed both as the context normally handles them (only batching
+//past CONTEXT_BATCH_THRESHOLD clip rects) and with batching forced on
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define BENCH_MIN_MS 200.0
+
+//Where the painted window sits, the same size as a calculator
+#define BENCH_WINDOW_X 200
+#define BENCH_WINDOW_Y 130
+#define BENCH_WINDOW_WIDTH 152
+#define BENCH_WINDOW_HEIGHT 215
+
+typedef struct BenchClip_struct {
+    char* name;
+    int holes; //Covering windows, along each side of a grid of them
+} BenchClip;
+
+BenchClip bench_clips[] = {
+    { "whole", 0 },
+    { "4 covers", 2 },
+    { "36 covers", 6 },
+    { "144 covers", 12 }
+};
+
+Pixel* bench_buffer;
+Context* bench_context;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//Clip to the window, minus a grid of small rects standing in for windows
+//lying on top of it
+void bench_set_clip(BenchClip* clip) {
+
+    int row, column;
+    Rect rect;
+
+    Context_clear_clip_rects(bench_context);
+
+    rect.top = BENCH_WINDOW_Y;
+    rect.left = BENCH_WINDOW_X;
+    rect.bottom = BENCH_WINDOW_Y + BENCH_WINDOW_HEIGHT - 1;
+    rect.right = BENCH_WINDOW_X + BENCH_WINDOW_WIDTH - 1;
+    Context_add_clip_rect(bench_context, &rect);
+
+    for(row = 0; row < clip->holes; row++) {
+
+        for(column = 0; column < clip->holes; column++) {
+
+            rect.top = BENCH_WINDOW_Y + ((row * 2 + 1) * BENCH_WINDOW_HEIGHT) / (clip->holes * 2);
+            rect.left = BENCH_WINDOW_X + ((column * 2 + 1) * BENCH_WINDOW_WIDTH) / (clip->holes * 2);
+            rect.bottom = rect.top + 5;
+            rect.right = rect.left + 5;
+            Context_subtract_clip_rect(bench_context, &rect);
+        }
+    }
+}
+
+//What Window_draw_border and a calculator's buttons draw, minus the text
+void bench_paint(uint32_t color) {
+
+    int i, x, y;
+
+    bench_context->translate_x = BENCH_WINDOW_X;
+    bench_context->translate_y = BENCH_WINDOW_Y;
+
+    Context_draw_rect(bench_context, 0, 0, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, color);
+    Context_draw_rect(bench_context, 1, 1, BENCH_WINDOW_WIDTH - 2, BENCH_WINDOW_HEIGHT - 2, color);
+    Context_draw_rect(bench_context, 2, 2, BENCH_WINDOW_WIDTH - 4, BENCH_WINDOW_HEIGHT - 4, color);
+    Context_horizontal_line(bench_context, 3, 28, BENCH_WINDOW_WIDTH - 6, color);
+    Context_horizontal_line(bench_context, 3, 29, BENCH_WINDOW_WIDTH - 6, color);
+    Context_horizontal_line(bench_context, 3, 30, BENCH_WINDOW_WIDTH - 6, color);
+    Context_fill_rect(bench_context, 3, 3, BENCH_WINDOW_WIDTH - 6, 25, color ^ 0x00FFFFFF);
+
+    for(i = 0; i < 16; i++) {
+
+        x = 8 + (i % 4) * 35;
+        y = 61 + (i / 4) * 35;
+        Context_fill_rect(bench_context, x + 1, y + 1, 29, 29, color ^ 0x00FFFFFF);
+        Context_draw_rect(bench_context, x, y, 30, 30, color);
+        Context_draw_rect(bench_context, x + 3, y + 3, 24, 24, color);
+        Context_draw_rect(bench_context, x + 4, y + 4, 22, 22, color);
+    }
+
+    bench_context->translate_x = 0;
+    bench_context->translate_y = 0;
+}
+
+void bench_paint_batched(uint32_t color) {
+
+    Context_begin_batch(bench_context);
+    bench_paint(color);
+    Context_end_batch(bench_context);
+}
+
+void bench_paint_forced(uint32_t color) {
+
+    bench_context->batch_threshold = 0;
+    bench_paint_batched(color);
+    bench_context->batch_threshold = CONTEXT_BATCH_THRESHOLD;
+}
+
+//Run one variant for a while and print how long a paint took
+void bench_run(BenchClip* clip, char* variant_name, void (*paint)(uint32_t)) {
+
+    double start_ms, elapsed_ms;
+    unsigned long iterations = 0;
+
+    bench_context->stats.clip_rects_processed = 0;
+    start_ms = bench_now_ms();
+
+    do {
+
+        paint(0xFF000000 | iterations);
+        iterations++;
+        elapsed_ms = bench_now_ms() - start_ms;
+    } while(elapsed_ms < BENCH_MIN_MS);
+
+    printf("%-11s %3d clip rects %-9s %10.1f ns/paint %6lu clip rects/paint\n", clip->name,
+           bench_context->clip_region->count, variant_name, (elapsed_ms * 1000000.0) / iterations,
+           bench_context->stats.clip_rects_processed / iterations);
+}
+
+//Make sure batching draws exactly what the separate calls do
+int bench_check(void) {
+
+    Pixel* expected;
+    int matches;
+
+    if(!(expected = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 0;
+
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_paint(0xFF123456);
+    memcpy(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_paint_forced(0xFF123456);
+    matches = !memcmp(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    free(expected);
+
+    return matches;
+}
+
+int main(int argc, char* argv[]) {
+
+    unsigned int i;
+
+    if(!(bench_buffer = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 1;
+
+    if(!(bench_context = Context_new(BENCH_WIDTH, BENCH_HEIGHT, bench_buffer)))
+        return 1;
+
+    for(i = 0; i < sizeof(bench_clips) / sizeof(BenchClip); i++) {
+
+        bench_set_clip(&bench_clips[i]);
+
+        if(!bench_check()) {
+
+            printf("batching gave the wrong result for %s\n", bench_clips[i].name);
+            return 1;
+        }
+
+        bench_run(&bench_clips[i], "separate", bench_paint);
+        bench_run(&bench_clips[i], "batched", bench_paint_batched);
+        bench_run(&bench_clips[i], "forced", bench_paint_forced);
+    }
+
+    Context_delete(bench_context);
+    free(bench_buffer);
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../context.h"
+#include "../span.h"
+
+//================| Clip Mask Microbenchmark |================//
+
+//Times painting a calculator (its border, buttons and labels) through clip
+//regions cut up by more and more windows lying over it, once clipping
+//against each rect in turn and once through the clip mask. The clip gets
+//set again before every paint, the way Window_paint does it, so building
+//the mask is part of what gets timed
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define BENCH_MIN_MS 200.0
+
+//Where the painted window sits, the same size as a calculator
+#define BENCH_WINDOW_X 200
+#define BENCH_WINDOW_Y 130
+#define BENCH_WINDOW_WIDTH 152
+#define BENCH_WINDOW_HEIGHT 215
+
+//A mask_threshold no clip region will ever get past
+#define BENCH_NEVER_MASK 1000000
+
+typedef struct BenchClip_struct {
+    char* name;
+    int holes; //Covering windows, along each side of a grid of them
+} BenchClip;
+
+BenchClip bench_clips[] = {
+    { "whole", 0 },
+    { "4 covers", 2 },
+    { "36 covers", 6 },
+    { "144 covers", 12 },
+    { "576 covers", 24 },
+    { "1296 covers", 36 }
+};
+
+Pixel* bench_buffer;
+Pixel* bench_expected;
+Context* bench_context;
+Region* bench_region;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//The window, minus a grid of small rects standing in for windows lying on
+//top of it
+int bench_make_region(BenchClip* clip) {
+
+    int row, column;
+    Rect rect;
+
+    rect.top = BENCH_WINDOW_Y;
+    rect.left = BENCH_WINDOW_X;
+    rect.bottom = BENCH_WINDOW_Y + BENCH_WINDOW_HEIGHT - 1;
+    rect.right = BENCH_WINDOW_X + BENCH_WINDOW_WIDTH - 1;
+
+    if(!Region_set_rect(bench_region, &rect))
+        return 0;
+
+    for(row = 0; row < clip->holes; row++) {
+
+        for(column = 0; column < clip->holes; column++) {
+
+            rect.top = BENCH_WINDOW_Y + ((row * 2 + 1) * BENCH_WINDOW_HEIGHT) / (clip->holes * 2);
+            rect.left = BENCH_WINDOW_X + ((column * 2 + 1) * BENCH_WINDOW_WIDTH) / (clip->holes * 2);
+            rect.bottom = rect.top + 1;
+            rect.right = rect.left + 1;
+
+            if(!Region_subtract_rect(bench_region, &rect))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+//What Window_draw_border and a calculator's buttons draw
+void bench_paint(uint32_t color) {
+
+    int i, x, y;
+    char label[2];
+
+    Context_set_clip_region(bench_context, bench_region, (Region*)0);
+
+    bench_context->translate_x = BENCH_WINDOW_X;
+    bench_context->translate_y = BENCH_WINDOW_Y;
+
+    Context_draw_rect(bench_context, 0, 0, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, color);
+    Context_draw_rect(bench_context, 1, 1, BENCH_WINDOW_WIDTH - 2, BENCH_WINDOW_HEIGHT - 2, color);
+    Context_draw_rect(bench_context, 2, 2, BENCH_WINDOW_WIDTH - 4, BENCH_WINDOW_HEIGHT - 4, color);
+    Context_fill_rect(bench_context, 3, 3, BENCH_WINDOW_WIDTH - 6, 25, color ^ 0x00FFFFFF);
+    Context_fill_rect(bench_context, 3, 31, BENCH_WINDOW_WIDTH - 6, BENCH_WINDOW_HEIGHT - 34,
+                      color ^ 0x00808080);
+    Context_draw_text(bench_context, "Calculator", 10, 12, color);
+
+    label[1] = 0;
+
+    for(i = 0; i < 16; i++) {
+
+        x = 8 + (i % 4) * 35;
+        y = 61 + (i / 4) * 35;
+        label[0] = "789/456*123-0.=+"[i];
+        Context_fill_rect(bench_context, x + 1, y + 1, 29, 29, color ^ 0x00FFFFFF);
+        Context_draw_rect(bench_context, x, y, 30, 30, color);
+        Context_draw_rect(bench_context, x + 3, y + 3, 24, 24, color);
+        Context_draw_text(bench_context, label, x + 11, y + 9, color);
+    }
+
+    bench_context->translate_x = 0;
+    bench_context->translate_y = 0;
+}
+
+//Run one variant for a while and print how long a paint took
+void bench_run(BenchClip* clip, char* variant_name) {
+
+    double start_ms, elapsed_ms;
+    unsigned long iterations = 0;
+
+    start_ms = bench_now_ms();
+
+    do {
+
+        bench_paint(0xFF000000 | iterations);
+        iterations++;
+        elapsed_ms = bench_now_ms() - start_ms;
+    } while(elapsed_ms < BENCH_MIN_MS);
+
+    printf("%-11s %4d clip rects %-14s %10.1f ns/paint\n", clip->name, bench_region->count,
+           variant_name, (elapsed_ms * 1000000.0) / iterations);
+}
+
+//Paint with the current settings and compare against bench_expected, or
+//fill bench_expected in if expected is zero
+int bench_check(int expected) {
+
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_paint(0xFF123456);
+
+    if(!expected) {
+
+        memcpy(bench_expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+        return 1;
+    }
+
+    return !memcmp(bench_expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+}
+
+int main(int argc, char* argv[]) {
+
+    unsigned int i, j;
+    char* kernel_names[3];
+    char variant_name[32];
+    SpanBitsFunction kernels[3];
+    SpanBitsFunction best_kernel;
+    unsigned int kernel_count = 0;
+
+    if(!(bench_buffer = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 1;
+
+    if(!(bench_expected = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 1;
+
+    if(!(bench_context = Context_new(BENCH_WIDTH, BENCH_HEIGHT, bench_buffer)))
+        return 1;
+
+    if(!(bench_region = Region_new()))
+        return 1;
+
+    best_kernel = span_bits_kernel;
+    kernel_names[kernel_count] = "portable";
+    kernels[kernel_count++] = Span_fill_bits_portable;
+
+#ifdef SPAN_HAVE_X86
+    kernel_names[kernel_count] = "sse2";
+    kernels[kernel_count++] = Span_fill_bits_sse2;
+
+#ifdef SPAN_HAVE_AVX2_MASKS
+    if(Span_cpu_has_avx2()) {
+
+        kernel_names[kernel_count] = "avx2";
+        kernels[kernel_count++] = Span_fill_bits_avx2;
+    }
+#endif
+#endif
+
+    for(i = 0; i < sizeof(bench_clips) / sizeof(BenchClip); i++) {
+
+        if(!bench_make_region(&bench_clips[i]))
+            return 1;
+
+        bench_context->mask_threshold = BENCH_NEVER_MASK;
+        bench_check(0);
+        bench_run(&bench_clips[i], "rects");
+
+        //Every kernel has to draw exactly what clipping to rects does
+        bench_context->mask_threshold = 0;
+
+        for(j = 0; j < kernel_count; j++) {
+
+            span_bits_kernel = kernels[j];
+
+            if(!bench_check(1)) {
+
+                printf("%s mask kernel gave the wrong result for %s\n",
+                       kernel_names[j], bench_clips[i].name);
+                return 1;
+            }
+
+            sprintf(variant_name, "mask (%s)", kernel_names[j]);
+            bench_run(&bench_clips[i], variant_name);
+        }
+
+        span_bits_kernel = best_kernel;
+    }
+
+    Region_delete(bench_region);
+    Context_delete(bench_context);
+    free(bench_expected);
+    free(bench_buffer);
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../span.h"
+
+//================| Span Fill Microbenchmark |================//
+
+//Times the span fill kernels against the per-pixel loop that
+//Context_clipped_rect used to run, on a few rectangle shapes that show up
+//a lot when painting: whole-screen fills, window backgrounds, and the
+//skinny rects that lines and borders turn into
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define BENCH_MIN_MS 200.0
+
+typedef struct BenchShape_struct {
+    char* name;
+    int x;
+    int y;
+    int width;
+    int height;
+} BenchShape;
+
+BenchShape bench_shapes[] = {
+    { "full screen", 0, 0, BENCH_WIDTH, BENCH_HEIGHT },
+    { "window background", 203, 134, 145, 170 },
+    { "horizontal line", 5, 300, 139, 1 },
+    { "vertical line", 77, 10, 1, 200 }
+};
+
+Pixel* bench_buffer;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//The original fill loop, recalculating every pixel's address
+void bench_fill_reference(BenchShape* shape, Pixel color) {
+
+    int cur_x, y;
+    int max_x = shape->x + shape->width;
+    int max_y = shape->y + shape->height;
+
+    for(y = shape->y; y < max_y; y++) 
+        for(cur_x = shape->x; cur_x < max_x; cur_x++) 
+            bench_buffer[y * BENCH_WIDTH + cur_x] = color;
+}
+
+//The new fill path, with the given kernel handling the rows
+void bench_fill_kernel(BenchShape* shape, Pixel color, SpanFillFunction kernel) {
+
+    span_fill_kernel = kernel;
+    Span_fill_rect(bench_buffer + (shape->y * BENCH_WIDTH) + shape->x, BENCH_WIDTH,
+                   color, shape->width, shape->height);
+}
+
+//Run one fill variant for a while and print its throughput. A null
+//kernel means the reference loop
+void bench_run(BenchShape* shape, char* kernel_name, SpanFillFunction kernel) {
+
+    double start_ms, elapsed_ms;
+    unsigned long iterations = 0;
+    double bytes;
+
+    start_ms = bench_now_ms();
+
+    do {
+
+        //Vary the color so that nothing can be hoisted out of the loop
+        if(kernel)
+            bench_fill_kernel(shape, Pixel_from_color(0xFF000000 | iterations), kernel);
+        else
+            bench_fill_reference(shape, Pixel_from_color(0xFF000000 | iterations));
+
+        iterations++;
+        elapsed_ms = bench_now_ms() - start_ms;
+    } while(elapsed_ms < BENCH_MIN_MS);
+
+    bytes = (double)iterations * shape->width * shape->height * sizeof(Pixel);
+
+    printf("%-18s %-9s %10.3f GB/s %12.1f ns/fill\n", shape->name, kernel_name,
+           bytes / (elapsed_ms * 1000000.0), (elapsed_ms * 1000000.0) / iterations);
+}
+
+//Make sure a kernel writes exactly what the reference loop does
+int bench_check(BenchShape* shape, SpanFillFunction kernel) {
+
+    Pixel* expected;
+    int matches;
+
+    if(!(expected = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 0;
+
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_fill_reference(shape, Pixel_from_color(0xFF123456));
+    memcpy(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_fill_kernel(shape, Pixel_from_color(0xFF123456), kernel);
+    matches = !memcmp(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    free(expected);
+
+    return matches;
+}
+
+int main(int argc, char* argv[]) {
+
+    unsigned int i, j;
+    char* kernel_names[3];
+    SpanFillFunction kernels[3];
+    unsigned int kernel_count = 0;
+
+    if(!(bench_buffer = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 1;
+
+    kernel_names[kernel_count] = "portable";
+    kernels[kernel_count++] = Span_fill_portable;
+
+#ifdef SPAN_HAVE_X86
+    kernel_names[kernel_count] = "sse2";
+    kernels[kernel_count++] = Span_fill_sse2;
+
+    if(Span_cpu_has_avx2()) {
+
+        kernel_names[kernel_count] = "avx2";
+        kernels[kernel_count++] = Span_fill_avx2;
+    }
+#endif
+
+    for(i = 0; i < sizeof(bench_shapes) / sizeof(BenchShape); i++) {
+
+        bench_run(&bench_shapes[i], "loop", (SpanFillFunction)0);
+
+        for(j = 0; j < kernel_count; j++) {
+
+            if(!bench_check(&bench_shapes[i], kernels[j])) {
+
+                printf("%s kernel gave the wrong result for %s\n", kernel_names[j], bench_shapes[i].name);
+                return 1;
+            }
+
+            bench_run(&bench_shapes[i], kernel_names[j], kernels[j]);
+        }
+    }
+
+    free(bench_buffer);
+
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "../list.h"
+#include "../rect.h"
+
+//================| List Microbenchmark |================//
+
+//Times the array-backed List against the doubly linked list it replaced,
+//on the ways the window system actually uses lists: building a big child
+//list and walking it by index (as every window.c loop does), walking it
+//with a cursor, and building a big list of clip rects and draining it from
+//the front (as the rect splitting code does)
+
+#define BENCH_ENTRIES 10000
+#define BENCH_MIN_MS 200.0
+
+//The old implementation, kept here for comparison
+typedef struct OldNode_struct {
+    void* payload;
+    struct OldNode_struct* prev;
+    struct OldNode_struct* next;
+} OldNode;
+
+typedef struct OldList_struct {
+    unsigned int count;
+    OldNode* root_node;
+} OldList;
+
+OldList* OldList_new() {
+
+    OldList* list;
+    if(!(list = (OldList*)malloc(sizeof(OldList))))
+        return list;
+
+    list->count = 0;
+    list->root_node = (OldNode*)0;
+
+    return list;
+}
+
+int OldList_add(OldList* list, void* payload) {
+
+    OldNode* current_node;
+    OldNode* new_node;
+    if(!(new_node = (OldNode*)malloc(sizeof(OldNode))))
+        return 0;
+
+    new_node->prev = (OldNode*)0;
+    new_node->next = (OldNode*)0;
+    new_node->payload = payload;
+
+    if(!list->root_node) {
+
+        list->root_node = new_node;
+    } else {
+
+        for(current_node = list->root_node; current_node->next; current_node = current_node->next);
+
+        current_node->next = new_node;
+        new_node->prev = current_node;
+    }
+
+    list->count++;
+
+    return 1;
+}
+
+void* OldList_get_at(OldList* list, unsigned int index) {
+
+    unsigned int current_index;
+    OldNode* current_node = list->root_node;
+
+    if(index >= list->count)
+        return (void*)0;
+
+    for(current_index = 0; current_index < index && current_node; current_index++)
+        current_node = current_node->next;
+
+    return current_node ? current_node->payload : (void*)0;
+}
+
+void* OldList_remove_at(OldList* list, unsigned int index) {
+
+    unsigned int current_index;
+    void* payload;
+    OldNode* current_node = list->root_node;
+
+    if(index >= list->count)
+        return (void*)0;
+
+    for(current_index = 0; current_index < index && current_node; current_index++)
+        current_node = current_node->next;
+
+    if(!current_node)
+        return (void*)0;
+
+    payload = current_node->payload;
+
+    if(current_node->prev)
+        current_node->prev->next = current_node->next;
+
+    if(current_node->next)
+        current_node->next->prev = current_node->prev;
+
+    if(index == 0)
+        list->root_node = current_node->next;
+
+    free(current_node);
+    list->count--;
+
+    return payload;
+}
+
+void OldList_delete(OldList* list) {
+
+    while(list->count)
+        OldList_remove_at(list, 0);
+
+    free(list);
+}
+
+//Stand-ins for the payloads
+Rect bench_rects[BENCH_ENTRIES];
+
+//Keeps the compiler from throwing the walks away
+uintptr_t bench_sink;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//One pass of each workload, on each implementation
+
+void bench_old_child_list(void) {
+
+    unsigned int i;
+    OldList* list = OldList_new();
+
+    for(i = 0; i < BENCH_ENTRIES; i++)
+        OldList_add(list, &bench_rects[i]);
+
+    for(i = 0; i < list->count; i++)
+        bench_sink += (uintptr_t)OldList_get_at(list, i);
+
+    OldList_delete(list);
+}
+
+void bench_new_child_list(void) {
+
+    unsigned int i;
+    List* list = List_new();
+
+    for(i = 0; i < BENCH_ENTRIES; i++)
+        List_add(list, &bench_rects[i]);
+
+    for(i = 0; i < list->count; i++)
+        bench_sink += (uintptr_t)List_get_at(list, i);
+
+    List_delete(list);
+}
+
+void bench_new_child_cursor(void) {
+
+    unsigned int i;
+    void* payload;
+    ListCursor cursor;
+    List* list = List_new();
+
+    for(i = 0; i < BENCH_ENTRIES; i++)
+        List_add(list, &bench_rects[i]);
+
+    List_cursor_start(list, &cursor);
+
+    while(List_cursor_next(&cursor, &payload))
+        bench_sink += (uintptr_t)payload;
+
+    List_delete(list);
+}
+
+void bench_old_clip_list(void) {
+
+    unsigned int i;
+    OldList* list = OldList_new();
+
+    for(i = 0; i < BENCH_ENTRIES; i++)
+        OldList_add(list, &bench_rects[i]);
+
+    while(list->count)
+        bench_sink += ((Rect*)OldList_remove_at(list, 0))->top;
+
+    OldList_delete(list);
+}
+
+void bench_new_clip_list(void) {
+
+    unsigned int i;
+    List* list = List_new();
+
+    for(i = 0; i < BENCH_ENTRIES; i++)
+        List_add(list, &bench_rects[i]);
+
+    while(list->count)
+        bench_sink += ((Rect*)List_remove_at(list, 0))->top;
+
+    List_delete(list);
+}
+
+typedef struct BenchCase_struct {
+    char* name;
+    char* variant;
+    void (*run)(void);
+} BenchCase;
+
+BenchCase bench_cases[] = {
+    { "child list", "linked", bench_old_child_list },
+    { "child list", "array", bench_new_child_list },
+    { "child list", "cursor", bench_new_child_cursor },
+    { "clip list", "linked", bench_old_clip_list },
+    { "clip list", "array", bench_new_clip_list }
+};
+
+//Run one case for a while and print how long a pass takes
+void bench_run(BenchCase* bench_case) {
+
+    double start_ms, elapsed_ms;
+    unsigned long iterations = 0;
+
+    start_ms = bench_now_ms();
+
+    do {
+
+        bench_case->run();
+        iterations++;
+        elapsed_ms = bench_now_ms() - start_ms;
+    } while(elapsed_ms < BENCH_MIN_MS);
+
+    printf("%-10s %-7s %12.3f ms/pass %10.1f ns/entry\n", bench_case->name, bench_case->variant,
+           elapsed_ms / iterations, (elapsed_ms * 1000000.0) / ((double)iterations * BENCH_ENTRIES));
+}
+
+int main(int argc, char* argv[]) {
+
+    unsigned int i;
+
+    for(i = 0; i < BENCH_ENTRIES; i++) {
+
+        bench_rects[i].top = i;
+        bench_rects[i].left = i;
+        bench_rects[i].bottom = i + 10;
+        bench_rects[i].right = i + 10;
+    }
+
+    printf("%u entries per list\n", BENCH_ENTRIES);
+
+    for(i = 0; i < sizeof(bench_cases) / sizeof(BenchCase); i++)
+        bench_run(&bench_cases[i]);
+
+    return bench_sink == 1;
+}
@@ -0,0 +1,379 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "../context.h"
+#include "../desktop.h"
+#include "../calculator.h"
+#include "../compositor.h"
+#include "../swapchain.h"
+#include "../../fake_lib/fake_os.h"
+
+//================| Scene Benchmark |================//
+
+//Runs the whole window system on the headless native backend through a
+//fixed set of scripted scenarios, feeding it mouse events the same way a
+//person would and timing each one from the moment it arrives until its
+//frame has been presented:
+//
+//  desktop_paint  Repainting the bare desktop from scratch
+//  spawn          Clicking the launcher to spawn each calculator
+//  drag           Dragging the top calculator across the stack of all of them
+//  buttons        Clicking through every button of the top calculator
+//  typing         Typing a long number into the top calculator's TextBox
+//
+//Usage: bench_scene [calculators]
+//
+//Each scenario prints one line of JSON so that runs can be saved and
+//compared from release to release. WSBE_THREADS and WSBE_RETAINED work
+//like they do for the regular build
+
+#define BENCH_DEFAULT_CALCULATORS 20
+#define BENCH_PAINT_REPEATS 50
+#define BENCH_DRAG_STEPS 200
+#define BENCH_BUTTON_ROUNDS 4
+#define BENCH_TYPED_DIGITS 200
+
+//Where the launcher button sits
+#define BENCH_LAUNCHER_X 60
+#define BENCH_LAUNCHER_Y 25
+
+//Calculators are grabbed this far into their titlebar
+#define BENCH_GRAB_X 60
+#define BENCH_GRAB_Y 15
+
+//Calculator button n of 16 is in this column and row, left to right and
+//top to bottom
+#define BENCH_BUTTON_X(n) (WIN_BORDERWIDTH + 5 + ((n) % 4) * 35 + 15)
+#define BENCH_BUTTON_Y(n) (WIN_TITLEHEIGHT + 30 + ((n) / 4) * 35 + 15)
+
+//The C button and the 1 through 9 buttons, as numbered above
+#define BENCH_BUTTON_C 12
+int bench_digit_buttons[9] = { 8, 9, 10, 4, 5, 6, 0, 1, 2 };
+
+//The results of one scenario
+typedef struct BenchScenario_struct {
+    char* name;
+    double* latencies; //Milliseconds for each measured event
+    int count;
+    int capacity;
+    unsigned long pixels_written;
+    unsigned long clip_rects_processed;
+    unsigned long clip_rects_created;
+    unsigned long paint_calls;
+    unsigned long presented_bytes;
+} BenchScenario;
+
+Desktop* desktop;
+Context* bench_context;
+BenchScenario* bench_scenario = (BenchScenario*)0;
+int bench_calculators;
+int bench_threads = 0;
+int bench_retained = 0;
+int bench_buffers = 0;
+SwapChain* bench_swap_chain = (SwapChain*)0;
+
+//The state at the start of the measurement in progress
+double bench_start_ms;
+ContextStats bench_start_stats;
+unsigned long bench_start_presented;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//The same presentation and per-frame handling as entry.c
+void present_damage(Context* context) {
+
+    int i;
+    fo_rect present_rects[CONTEXT_MAX_DAMAGE];
+
+    if(bench_swap_chain) {
+
+        SwapChain_present(bench_swap_chain);
+        return;
+    }
+
+    for(i = 0; i < context->damage_count; i++) {
+
+        present_rects[i].x = context->damage_rects[i].left;
+        present_rects[i].y = context->damage_rects[i].top;
+        present_rects[i].width = context->damage_rects[i].right - context->damage_rects[i].left + 1;
+        present_rects[i].height = context->damage_rects[i].bottom - context->damage_rects[i].top + 1;
+    }
+
+    fake_os_present(present_rects, context->damage_count);
+    Context_clear_damage(context);
+}
+
+void bench_frame_callback(void) {
+
+    uint16_t mouse_x, mouse_y;
+    uint8_t buttons;
+
+    while(fake_os_pollMouseEvent(&mouse_x, &mouse_y, &buttons))
+        Desktop_process_mouse(desktop, mouse_x, mouse_y, buttons);
+
+    present_damage(desktop->window.context);
+}
+
+void spawn_calculator(Button* button, int x, int y) {
+
+    Calculator* temp_calc = Calculator_new();
+    Window_insert_child((Window*)desktop, (Window*)temp_calc);
+    Window_move((Window*)temp_calc, 0, 0);
+}
+
+//Start and finish measuring one event (or other unit of work) into the
+//current scenario, if there is one
+void bench_measure_begin(void) {
+
+    bench_start_stats = bench_context->stats;
+    bench_start_presented = fake_os_getPresentedBytes();
+    bench_start_ms = bench_now_ms();
+}
+
+void bench_measure_end(void) {
+
+    double elapsed_ms = bench_now_ms() - bench_start_ms;
+    double* new_latencies;
+    BenchScenario* scenario = bench_scenario;
+
+    if(!scenario)
+        return;
+
+    if(scenario->count == scenario->capacity) {
+
+        scenario->capacity = scenario->capacity ? scenario->capacity * 2 : 256;
+
+        if(!(new_latencies = (double*)realloc(scenario->latencies,
+                                              sizeof(double) * scenario->capacity))) {
+
+            fprintf(stderr, "bench_scene: out of memory\n");
+            exit(1);
+        }
+
+        scenario->latencies = new_latencies;
+    }
+
+    scenario->latencies[scenario->count++] = elapsed_ms;
+    scenario->pixels_written += bench_context->stats.pixels_written - bench_start_stats.pixels_written;
+    scenario->clip_rects_processed += bench_context->stats.clip_rects_processed -
+                                      bench_start_stats.clip_rects_processed;
+    scenario->clip_rects_created += bench_context->stats.clip_rects_created -
+                                    bench_start_stats.clip_rects_created;
+    scenario->paint_calls += bench_context->stats.paint_calls - bench_start_stats.paint_calls;
+    scenario->presented_bytes += fake_os_getPresentedBytes() - bench_start_presented;
+}
+
+//Deliver a mouse event and wait for its frame, measuring it if we're
+//inside of a scenario
+void bench_event(int x, int y, uint8_t buttons) {
+
+    bench_measure_begin();
+    fake_os_pushMouseEvent(x, y, buttons);
+    bench_measure_end();
+}
+
+void bench_click(int x, int y) {
+
+    bench_event(x, y, 0);
+    bench_event(x, y, 1);
+    bench_event(x, y, 0);
+}
+
+//Move the mouse in a straight line, ending up exactly at x2, y2
+void bench_stroke(int x1, int y1, int x2, int y2, int steps, uint8_t buttons) {
+
+    int i;
+
+    for(i = 1; i <= steps; i++)
+        bench_event(x1 + ((x2 - x1) * i) / steps, y1 + ((y2 - y1) * i) / steps, buttons);
+}
+
+//Where the ith calculator gets put after being spawned, cascading across
+//the screen so that they overlap a little
+int bench_calculator_x(int i) {
+
+    return 180 + (i * 37) % 660;
+}
+
+int bench_calculator_y(int i) {
+
+    return 50 + (i * 23) % 500;
+}
+
+int bench_compare_latencies(const void* a, const void* b) {
+
+    double difference = *(double*)a - *(double*)b;
+
+    return difference < 0 ? -1 : difference > 0;
+}
+
+//Start a new scenario. Everything measured until it's finished counts toward it
+void bench_begin(BenchScenario* scenario, char* name) {
+
+    scenario->name = name;
+    scenario->latencies = (double*)0;
+    scenario->count = 0;
+    scenario->capacity = 0;
+    scenario->pixels_written = 0;
+    scenario->clip_rects_processed = 0;
+    scenario->clip_rects_created = 0;
+    scenario->paint_calls = 0;
+    scenario->presented_bytes = 0;
+    bench_scenario = scenario;
+}
+
+//Stop measuring and print the scenario's line of results
+void bench_finish(BenchScenario* scenario) {
+
+    int i;
+    double total_ms = 0.0;
+
+    bench_scenario = (BenchScenario*)0;
+
+    for(i = 0; i < scenario->count; i++)
+        total_ms += scenario->latencies[i];
+
+    qsort(scenario->latencies, scenario->count, sizeof(double), bench_compare_latencies);
+
+    printf("{\"scenario\": \"%s\", \"calculators\": %d, \"threads\": %d, \"retained\": %d, \"buffers\": %d, \"events\": %d, "
+           "\"ms_per_event\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, "
+           "\"pixels_written\": %lu, \"clip_rects_processed\": %lu, \"clip_rects_created\": %lu, "
+           "\"paint_calls\": %lu, \"presented_bytes\": %lu}\n",
+           scenario->name, bench_calculators, bench_threads, bench_retained, bench_buffers, scenario->count,
+           scenario->count ? total_ms / scenario->count : 0.0,
+           scenario->count ? scenario->latencies[(scenario->count - 1) / 2] : 0.0,
+           scenario->count ? scenario->latencies[((scenario->count - 1) * 99) / 100] : 0.0,
+           scenario->pixels_written, scenario->clip_rects_processed, scenario->clip_rects_created,
+           scenario->paint_calls, scenario->presented_bytes);
+
+    free(scenario->latencies);
+}
+
+int main(int argc, char* argv[]) {
+
+    int i, round, x, y;
+    char* thread_count;
+    char* buffer_count;
+    Button* launch_button;
+    BenchScenario scenario;
+
+    bench_calculators = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_CALCULATORS;
+
+    if(bench_calculators < 1) {
+
+        fprintf(stderr, "usage: bench_scene [calculators]\n");
+        return 1;
+    }
+
+    //Set up the same scene entry.c does
+    if(!(bench_context = Context_new(0, 0, 0)))
+        return 1;
+
+    if((buffer_count = getenv("WSBE_BUFFERS")) &&
+       (bench_swap_chain = SwapChain_new(bench_context, atoi(buffer_count))))
+        bench_buffers = atoi(buffer_count);
+    else
+        bench_context->buffer = fake_os_getActiveVesaBuffer(&bench_context->width,
+                                                            &bench_context->height);
+
+    if((thread_count = getenv("WSBE_THREADS")) &&
+       (bench_context->compositor = Compositor_new(bench_context, atoi(thread_count))))
+        bench_threads = atoi(thread_count);
+
+    if(!(desktop = Desktop_new(bench_context)))
+        return 1;
+
+    if(getenv("WSBE_RETAINED"))
+        desktop->window.retain_children = bench_retained = 1;
+
+    launch_button = Button_new(10, 10, 150, 30);
+    Window_set_title((Window*)launch_button, "New Calculator");
+    launch_button->onmousedown = spawn_calculator;
+    Window_insert_child((Window*)desktop, (Window*)launch_button);
+
+    //Every event gets its own frame, so that each one can be timed
+    fake_os_installFrameCallback(bench_frame_callback);
+
+    bench_begin(&scenario, "desktop_paint");
+
+    for(i = 0; i < BENCH_PAINT_REPEATS; i++) {
+
+        bench_measure_begin();
+        Window_paint((Window*)desktop, (Region*)0, 1);
+        Arena_reset(bench_context->frame_arena);
+        present_damage(bench_context);
+        bench_measure_end();
+    }
+
+    bench_finish(&scenario);
+
+    //Each new calculator lands on top of the launcher, so after timing its
+    //spawn we drag it out of the way (without timing that)
+    bench_begin(&scenario, "spawn");
+
+    for(i = 0; i < bench_calculators; i++) {
+
+        bench_scenario = &scenario;
+        bench_click(BENCH_LAUNCHER_X, BENCH_LAUNCHER_Y);
+        bench_scenario = (BenchScenario*)0;
+
+        x = bench_calculator_x(i) + BENCH_GRAB_X;
+        y = bench_calculator_y(i) + BENCH_GRAB_Y;
+        bench_event(BENCH_GRAB_X, BENCH_GRAB_Y, 1);
+        bench_stroke(BENCH_GRAB_X, BENCH_GRAB_Y, x, y, 4, 1);
+        bench_event(x, y, 0);
+    }
+
+    bench_finish(&scenario);
+
+    //Grab the last one spawned by its titlebar, take it to the top left of
+    //the stack, then all the way over to the bottom right
+    x = bench_calculator_x(bench_calculators - 1) + BENCH_GRAB_X;
+    y = bench_calculator_y(bench_calculators - 1) + BENCH_GRAB_Y;
+    bench_begin(&scenario, "drag");
+    bench_event(x, y, 1);
+    bench_stroke(x, y, bench_calculator_x(0) + BENCH_GRAB_X,
+                 bench_calculator_y(0) + BENCH_GRAB_Y, BENCH_DRAG_STEPS / 2, 1);
+    x = bench_calculator_x(0) + 660 + BENCH_GRAB_X;
+    y = bench_calculator_y(0) + 500 + BENCH_GRAB_Y;
+    bench_stroke(bench_calculator_x(0) + BENCH_GRAB_X, bench_calculator_y(0) + BENCH_GRAB_Y,
+                 x, y, BENCH_DRAG_STEPS / 2, 1);
+    bench_event(x, y, 0);
+    bench_finish(&scenario);
+
+    //From here on, x and y are where the top calculator is
+    x -= BENCH_GRAB_X;
+    y -= BENCH_GRAB_Y;
+
+    bench_begin(&scenario, "buttons");
+
+    for(round = 0; round < BENCH_BUTTON_ROUNDS; round++)
+        for(i = 0; i < 16; i++)
+            bench_click(x + BENCH_BUTTON_X(i), y + BENCH_BUTTON_Y(i));
+
+    bench_finish(&scenario);
+
+    //Clear the display first (without timing it), then key in digits until
+    //the number is far too long for the TextBox
+    bench_click(x + BENCH_BUTTON_X(BENCH_BUTTON_C), y + BENCH_BUTTON_Y(BENCH_BUTTON_C));
+    bench_begin(&scenario, "typing");
+
+    for(i = 0; i < BENCH_TYPED_DIGITS; i++)
+        bench_click(x + BENCH_BUTTON_X(bench_digit_buttons[i % 9]),
+                    y + BENCH_BUTTON_Y(bench_digit_buttons[i % 9]));
+
+    bench_finish(&scenario);
+
+    if(bench_context->compositor)
+        Compositor_delete(bench_context->compositor);
+
+    return 0;
+}
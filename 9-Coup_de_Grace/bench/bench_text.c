@@ -0,0 +1,209 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../context.h"
+#include "../span.h"
+
+//================| Text Drawing Microbenchmark |================//
+
+//Times Context_draw_text with each of the masked span kernels against the
+//bit-at-a-time loop it used to run, both for whole strings and for strings
+//hanging off the edge of a clip rect (the partial-glyph case)
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 768
+#define BENCH_MIN_MS 200.0
+
+typedef struct BenchText_struct {
+    char* name;
+    char* string;
+    int x;
+    int y;
+    Rect clip;
+} BenchText;
+
+BenchText bench_texts[] = {
+    { "title bar", "Calculator 3 - Untitled", 120, 80, { 0, 0, BENCH_HEIGHT - 1, BENCH_WIDTH - 1 } },
+    { "long line", "The quick brown fox jumps over the lazy dog. 0123456789!?", 3, 400,
+      { 0, 0, BENCH_HEIGHT - 1, BENCH_WIDTH - 1 } },
+    { "clipped", "The quick brown fox jumps over the lazy dog. 0123456789!?", 98, 203,
+      { 207, 101, 211, 301 } }
+};
+
+extern uint8_t font_array[];
+Pixel* bench_buffer;
+Context* bench_context;
+
+double bench_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//The original glyph loop, testing one font bit per pixel
+void bench_text_reference(BenchText* text, uint32_t color) {
+
+    int font_x, font_y, x, off_x, off_y, count_x, count_y;
+    uint8_t shift_line;
+    char* string;
+    char character;
+    Rect* bound_rect = &text->clip;
+    int y = text->y;
+
+    for(string = text->string, x = text->x; *string; string++, x += 8) {
+
+        character = *string & 0x7F;
+        off_x = off_y = 0;
+        count_x = 8;
+        count_y = 12;
+
+        if(x > bound_rect->right || (x + 8) <= bound_rect->left ||
+           y > bound_rect->bottom || (y + 12) <= bound_rect->top)
+            continue;
+
+        if(x < bound_rect->left)
+            off_x = bound_rect->left - x;
+
+        if((x + 8) > bound_rect->right)
+            count_x = bound_rect->right - x + 1;
+
+        if(y < bound_rect->top)
+            off_y = bound_rect->top - y;
+
+        if((y + 12) > bound_rect->bottom)
+            count_y = bound_rect->bottom - y + 1;
+
+        for(font_y = off_y; font_y < count_y; font_y++) {
+
+            shift_line = font_array[font_y * 128 + character];
+            shift_line <<= off_x;
+
+            for(font_x = off_x; font_x < count_x; font_x++) {
+
+                if(shift_line & 0x80)
+                    bench_buffer[(font_y + y) * BENCH_WIDTH + (font_x + x)] = Pixel_from_color(color);
+
+                shift_line <<= 1;
+            }
+        }
+    }
+}
+
+//The new path, with the given kernel handling the glyph rows. Given the
+//portable kernel, Context draws the rows a bit at a time instead, the way
+//it does when there's no vector kernel to use
+void bench_text_kernel(BenchText* text, uint32_t color, SpanMaskFunction kernel) {
+
+    span_mask_kernel = kernel;
+    Context_draw_text(bench_context, text->string, text->x, text->y, color);
+}
+
+//Clip the context to the text's bounds
+void bench_set_clip(BenchText* text) {
+
+    Context_clear_clip_rects(bench_context);
+    Context_add_clip_rect(bench_context, &text->clip);
+}
+
+//Run one variant for a while and print its throughput. A null
+//kernel means the reference loop
+void bench_run(BenchText* text, char* kernel_name, SpanMaskFunction kernel) {
+
+    double start_ms, elapsed_ms;
+    unsigned long iterations = 0;
+    double glyphs;
+
+    start_ms = bench_now_ms();
+
+    do {
+
+        if(kernel)
+            bench_text_kernel(text, 0xFF000000 | iterations, kernel);
+        else
+            bench_text_reference(text, 0xFF000000 | iterations);
+
+        iterations++;
+        elapsed_ms = bench_now_ms() - start_ms;
+    } while(elapsed_ms < BENCH_MIN_MS);
+
+    glyphs = (double)iterations * strlen(text->string);
+
+    printf("%-10s %-9s %10.1f Mglyph/s %10.1f ns/string\n", text->name, kernel_name,
+           glyphs / (elapsed_ms * 1000.0), (elapsed_ms * 1000000.0) / iterations);
+}
+
+//Make sure a kernel draws exactly what the reference loop does
+int bench_check(BenchText* text, SpanMaskFunction kernel) {
+
+    Pixel* expected;
+    int matches;
+
+    if(!(expected = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 0;
+
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_text_reference(text, 0xFF123456);
+    memcpy(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    memset(bench_buffer, 0, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    bench_text_kernel(text, 0xFF123456, kernel);
+    matches = !memcmp(expected, bench_buffer, sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT);
+    free(expected);
+
+    return matches;
+}
+
+int main(int argc, char* argv[]) {
+
+    unsigned int i, j;
+    char* kernel_names[3];
+    SpanMaskFunction kernels[3];
+    unsigned int kernel_count = 0;
+
+    if(!(bench_buffer = (Pixel*)malloc(sizeof(Pixel) * BENCH_WIDTH * BENCH_HEIGHT)))
+        return 1;
+
+    if(!(bench_context = Context_new(BENCH_WIDTH, BENCH_HEIGHT, bench_buffer)))
+        return 1;
+
+    kernel_names[kernel_count] = "portable";
+    kernels[kernel_count++] = Span_fill_masked_portable;
+
+#ifdef SPAN_HAVE_X86
+    kernel_names[kernel_count] = "sse2";
+    kernels[kernel_count++] = Span_fill_masked_sse2;
+
+#ifdef SPAN_HAVE_AVX2_MASKS
+    if(Span_cpu_has_avx2()) {
+
+        kernel_names[kernel_count] = "avx2";
+        kernels[kernel_count++] = Span_fill_masked_avx2;
+    }
+#endif
+#endif
+
+    for(i = 0; i < sizeof(bench_texts) / sizeof(BenchText); i++) {
+
+        bench_set_clip(&bench_texts[i]);
+        bench_run(&bench_texts[i], "loop", (SpanMaskFunction)0);
+
+        for(j = 0; j < kernel_count; j++) {
+
+            if(!bench_check(&bench_texts[i], kernels[j])) {
+
+                printf("%s kernel gave the wrong result for %s\n", kernel_names[j], bench_texts[i].name);
+                return 1;
+            }
+
+            bench_run(&bench_texts[i], kernel_names[j], kernels[j]);
+        }
+    }
+
+    free(bench_buffer);
+
+    return 0;
+}
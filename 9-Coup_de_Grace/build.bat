@@ -1 +1 @@
-emcc -c -o listnode.bc listnode.c & emcc -c -o list.bc list.c & emcc -c -o context.bc context.c & emcc -c -o window.bc window.c & emcc -c -o desktop.bc desktop.c & emcc -c -o entry.bc entry.c  & emcc -c -o rect.bc rect.c & emcc -c -o button.bc button.c & emcc -c -o textbox.bc textbox.c & emcc -c -o calculator.bc calculator.c & emcc -c -o ..\fake_lib\fake_os.bc ..\fake_lib\fake_os.c & emcc -o ..\current_build.js ..\fake_lib\fake_os.bc listnode.bc calculator.bc textbox.bc button.bc list.bc context.bc window.bc desktop.bc entry.bc rect.bc -g -s NO_EXIT_RUNTIME=1
+emcc -c -o list.bc list.c %* & emcc -c -o context.bc context.c %* & emcc -c -o window.bc window.c %* & emcc -c -o desktop.bc desktop.c %* & emcc -c -o entry.bc entry.c %* & emcc -c -o button.bc button.c %* & emcc -c -o textbox.bc textbox.c %* & emcc -c -o calculator.bc calculator.c %* & emcc -c -o span.bc span.c %* & emcc -c -o region.bc region.c %* & emcc -c -o arena.bc arena.c %* & emcc -c -o compositor.bc compositor.c %* & emcc -c -o displaylist.bc displaylist.c %* & emcc -c -o spatialgrid.bc spatialgrid.c %* & emcc -c -o statshud.bc statshud.c %* & emcc -c -o heatmap.bc heatmap.c %* & emcc -c -o swapchain.bc swapchain.c %* & emcc -c -o ..\fake_lib\fake_os.bc ..\fake_lib\fake_os.c %* & emcc -o ..\current_build.js ..\fake_lib\fake_os.bc calculator.bc textbox.bc button.bc list.bc context.bc window.bc desktop.bc entry.bc span.bc region.bc arena.bc compositor.bc displaylist.bc spatialgrid.bc statshud.bc heatmap.bc swapchain.bc -g -s NO_EXIT_RUNTIME=1
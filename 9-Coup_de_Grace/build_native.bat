@@ -0,0 +1,8 @@
+gcc -O2 -g -pthread -o ..\native_build.exe ..\fake_lib\fake_os_native.c textbox.c calculator.c button.c list.c context.c window.c desktop.c entry.c span.c region.c arena.c compositor.c displaylist.c spatialgrid.c statshud.c heatmap.c swapchain.c %*
+
+gcc -O2 -g -o bench\bench_fill.exe bench\bench_fill.c span.c %*
+gcc -O2 -g -o bench\bench_text.exe bench\bench_text.c context.c list.c region.c arena.c span.c displaylist.c %*
+gcc -O2 -g -o bench\bench_batch.exe bench\bench_batch.c context.c list.c region.c arena.c span.c displaylist.c %*
+gcc -O2 -g -o bench\bench_clip.exe bench\bench_clip.c context.c list.c region.c arena.c span.c displaylist.c %*
+gcc -O2 -g -o bench\bench_list.exe bench\bench_list.c list.c arena.c %*
+gcc -O2 -g -pthread -o bench\bench_scene.exe bench\bench_scene.c ..\fake_lib\fake_os_native.c textbox.c calculator.c button.c list.c context.c window.c desktop.c span.c region.c arena.c compositor.c displaylist.c spatialgrid.c swapchain.c %*
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+#Builds against the headless native fake_os backend with the host compiler
+#so that the window system can be run, profiled and benchmarked outside of a browser.
+#Anything given on the command line gets passed on to the compiler, such as
+#-DFO_PIXEL_FORMAT=FO_PIXEL_RGB565 to build for a 16-bit screen (see fake_os.h)
+cc -O2 -g -pthread -o ../native_build ../fake_lib/fake_os_native.c textbox.c calculator.c button.c list.c context.c window.c desktop.c entry.c span.c region.c arena.c compositor.c displaylist.c spatialgrid.c statshud.c heatmap.c swapchain.c "$@"
+
+#Benchmarks
+cc -O2 -g -o bench/bench_fill bench/bench_fill.c span.c "$@"
+cc -O2 -g -o bench/bench_text bench/bench_text.c context.c list.c region.c arena.c span.c displaylist.c "$@"
+cc -O2 -g -o bench/bench_batch bench/bench_batch.c context.c list.c region.c arena.c span.c displaylist.c "$@"
+cc -O2 -g -o bench/bench_clip bench/bench_clip.c context.c list.c region.c arena.c span.c displaylist.c "$@"
+cc -O2 -g -o bench/bench_list bench/bench_list.c list.c arena.c "$@"
+cc -O2 -g -pthread -o bench/bench_scene bench/bench_scene.c ../fake_lib/fake_os_native.c textbox.c calculator.c button.c list.c context.c window.c desktop.c span.c region.c arena.c compositor.c displaylist.c spatialgrid.c swapchain.c "$@"
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "button.h"
 
 Button* Button_new(int x, int y, int w, int h) {
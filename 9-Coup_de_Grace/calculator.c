@@ -1,6 +1,7 @@
 #include "calculator.h"
 #include "textbox.h"
 #include <inttypes.h>
+#include <stdlib.h>
 
 void Calculator_button_handler(Button* button, int x, int y) {
 
@@ -0,0 +1,333 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "compositor.h"
+
+//================| Compositor Class Implementation |================//
+
+//Pack and unpack the two ends of a worker's task deque
+#define COMPOSITOR_RANGE(head, tail) (((uint64_t)(tail) << 32) | (uint32_t)(head))
+#define COMPOSITOR_HEAD(range) ((int)(uint32_t)(range))
+#define COMPOSITOR_TAIL(range) ((int)((range) >> 32))
+
+//Take the next task off the front of our own deque, or -1 if it's empty
+int Compositor_pop_task(CompositorWorker* worker) {
+
+    uint64_t range = __atomic_load_n(&worker->task_range, __ATOMIC_ACQUIRE);
+
+    while(COMPOSITOR_HEAD(range) < COMPOSITOR_TAIL(range)) {
+
+        //If someone stole from us in the meantime, range gets reloaded
+        //and we try again
+        if(__atomic_compare_exchange_n(&worker->task_range, &range,
+                                       COMPOSITOR_RANGE(COMPOSITOR_HEAD(range) + 1,
+                                                        COMPOSITOR_TAIL(range)),
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return worker->tasks[COMPOSITOR_HEAD(range)];
+    }
+
+    return -1;
+}
+
+//Take a task off the back of someone else's deque, or -1 if it's empty
+int Compositor_steal_task(CompositorWorker* victim) {
+
+    uint64_t range = __atomic_load_n(&victim->task_range, __ATOMIC_ACQUIRE);
+
+    while(COMPOSITOR_HEAD(range) < COMPOSITOR_TAIL(range)) {
+
+        if(__atomic_compare_exchange_n(&victim->task_range, &range,
+                                       COMPOSITOR_RANGE(COMPOSITOR_HEAD(range),
+                                                        COMPOSITOR_TAIL(range) - 1),
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return victim->tasks[COMPOSITOR_TAIL(range) - 1];
+    }
+
+    return -1;
+}
+
+//Paint tiles until there are none left anywhere
+void Compositor_run_tasks(CompositorWorker* worker) {
+
+    int i, tile, index;
+    Compositor* compositor = worker->compositor;
+
+    //Everything we draw on the screen context goes to our own instead
+    Context_set_thread_target(compositor->context, worker->context);
+
+    index = worker - compositor->workers;
+
+    while(1) {
+
+        tile = Compositor_pop_task(worker);
+
+        //Out of our own work, so go looking for someone else's, starting
+        //with our neighbor so that thieves spread themselves out
+        for(i = 1; tile < 0 && i < compositor->worker_count; i++)
+            tile = Compositor_steal_task(&compositor->workers[(index + i) % compositor->worker_count]);
+
+        if(tile < 0)
+            break;
+
+        Window_paint(compositor->paint_window, compositor->tile_dirty[tile], 1);
+    }
+
+    Context_set_thread_target((Context*)0, (Context*)0);
+}
+
+//Worker thread body: wait for a job, help with it, repeat
+void* Compositor_thread(void* argument) {
+
+    CompositorWorker* worker = (CompositorWorker*)argument;
+    Compositor* compositor = worker->compositor;
+    unsigned int last_generation = 0;
+
+    while(1) {
+
+        pthread_mutex_lock(&compositor->lock);
+
+        while(compositor->generation == last_generation && !compositor->quitting)
+            pthread_cond_wait(&compositor->start_condition, &compositor->lock);
+
+        if(compositor->quitting) {
+
+            pthread_mutex_unlock(&compositor->lock);
+            break;
+        }
+
+        last_generation = compositor->generation;
+        pthread_mutex_unlock(&compositor->lock);
+
+        Compositor_run_tasks(worker);
+
+        pthread_mutex_lock(&compositor->lock);
+
+        if(!--compositor->busy_workers)
+            pthread_cond_signal(&compositor->done_condition);
+
+        pthread_mutex_unlock(&compositor->lock);
+    }
+
+    return (void*)0;
+}
+
+//Free everything a (possibly half-built) compositor holds, stopping any
+//threads that were started
+void Compositor_delete(Compositor* compositor) {
+
+    int i;
+
+    pthread_mutex_lock(&compositor->lock);
+    compositor->quitting = 1;
+    pthread_cond_broadcast(&compositor->start_condition);
+    pthread_mutex_unlock(&compositor->lock);
+
+    for(i = 0; i < compositor->worker_count; i++) {
+
+        if(i)
+            pthread_join(compositor->workers[i].thread, (void**)0);
+
+        free(compositor->workers[i].tasks);
+        Context_delete(compositor->workers[i].context);
+    }
+
+    for(i = 0; i < compositor->tile_columns * compositor->tile_rows; i++)
+        Region_delete(compositor->tile_dirty[i]);
+
+    pthread_mutex_destroy(&compositor->lock);
+    pthread_cond_destroy(&compositor->start_condition);
+    pthread_cond_destroy(&compositor->done_condition);
+    free(compositor->tile_dirty);
+    free(compositor->workers);
+    free(compositor);
+}
+
+//Create a compositor for the passed context with the given number of
+//threads (counting the one that will be calling Compositor_paint)
+//Returns null if that fails, or if there's no point with one thread
+Compositor* Compositor_new(Context* context, int thread_count) {
+
+    int i, tile_count;
+    Compositor* compositor;
+    CompositorWorker* worker;
+
+    if(thread_count < 2)
+        return (Compositor*)0;
+
+    if(!(compositor = (Compositor*)malloc(sizeof(Compositor))))
+        return compositor;
+
+    compositor->context = context;
+    compositor->worker_count = 0;
+    compositor->tile_columns = (context->width + COMPOSITOR_TILE_SIZE - 1) / COMPOSITOR_TILE_SIZE;
+    compositor->tile_rows = (context->height + COMPOSITOR_TILE_SIZE - 1) / COMPOSITOR_TILE_SIZE;
+    compositor->generation = 0;
+    compositor->busy_workers = 0;
+    compositor->quitting = 0;
+    compositor->paint_window = (Window*)0;
+    tile_count = compositor->tile_columns * compositor->tile_rows;
+
+    pthread_mutex_init(&compositor->lock, (pthread_mutexattr_t*)0);
+    pthread_cond_init(&compositor->start_condition, (pthread_condattr_t*)0);
+    pthread_cond_init(&compositor->done_condition, (pthread_condattr_t*)0);
+
+    compositor->workers = (CompositorWorker*)malloc(sizeof(CompositorWorker) * thread_count);
+    compositor->tile_dirty = (Region**)calloc(tile_count, sizeof(Region*));
+
+    if(!compositor->workers || !compositor->tile_dirty) {
+
+        compositor->tile_columns = 0;
+        Compositor_delete(compositor);
+        return (Compositor*)0;
+    }
+
+    for(i = 0; i < tile_count; i++) {
+
+        if(!(compositor->tile_dirty[i] = Region_new())) {
+
+            //Only delete as many as we made
+            compositor->tile_columns = i;
+            compositor->tile_rows = 1;
+            Compositor_delete(compositor);
+            return (Compositor*)0;
+        }
+    }
+
+    //Set up the workers. The first one is the calling thread, so it
+    //doesn't get a thread of its own
+    for(i = 0; i < thread_count; i++) {
+
+        worker = &compositor->workers[i];
+        worker->compositor = compositor;
+        worker->task_range = 0;
+        worker->tasks = (int*)malloc(sizeof(int) * tile_count);
+        worker->context = Context_new_worker(context);
+
+        if(!worker->tasks || !worker->context ||
+           (i && pthread_create(&worker->thread, (pthread_attr_t*)0, Compositor_thread, worker))) {
+
+            free(worker->tasks);
+
+            if(worker->context)
+                Context_delete(worker->context);
+
+            Compositor_delete(compositor);
+            return (Compositor*)0;
+        }
+
+        compositor->worker_count++;
+    }
+
+    return compositor;
+}
+
+//Repaint a window and all of its children, tile by tile across all of the
+//threads. Works like Window_paint(window, dirty_region, 1) and takes care
+//of adding the painted area to the screen context's damage
+//Returns zero if the job wasn't worth splitting up, in which case nothing
+//was painted and the caller should paint normally
+int Compositor_paint(Compositor* compositor, Window* window, Region* dirty_region) {
+
+    int i, j, tile, tile_count, used_tiles;
+    Rect tile_rect;
+    CompositorWorker* worker;
+    Context* worker_context;
+
+    //We're already painting one of the tiles
+    if(Context_for_thread(compositor->context) != compositor->context)
+        return 0;
+
+    //Painting reads the clipping caches and display lists, which would
+    //otherwise get rebuilt on the fly. Make sure they're all current before
+    //anyone starts so that the tree is strictly read-only while the tiles
+    //are being painted
+    if(!Window_prepare_paint(window))
+        return 0;
+
+    //Work out which tiles the job touches
+    tile_count = compositor->tile_columns * compositor->tile_rows;
+    used_tiles = 0;
+
+    for(i = 0; i < compositor->worker_count; i++)
+        compositor->workers[i].task_range = 0;
+
+    for(tile = 0; tile < tile_count; tile++) {
+
+        tile_rect.top = (tile / compositor->tile_columns) * COMPOSITOR_TILE_SIZE;
+        tile_rect.left = (tile % compositor->tile_columns) * COMPOSITOR_TILE_SIZE;
+        tile_rect.bottom = tile_rect.top + COMPOSITOR_TILE_SIZE - 1;
+        tile_rect.right = tile_rect.left + COMPOSITOR_TILE_SIZE - 1;
+
+        //Nothing we paint can land outside of the window's visible area
+        if(!Region_intersects_rect(window->visible_region, &tile_rect))
+            continue;
+
+        if(!Region_set_rect(compositor->tile_dirty[tile], &tile_rect))
+            return 0;
+
+        if(dirty_region) {
+
+            if(!Region_intersect(compositor->tile_dirty[tile], compositor->tile_dirty[tile], dirty_region))
+                return 0;
+
+            if(!compositor->tile_dirty[tile]->count)
+                continue;
+        }
+
+        //Deal it out
+        worker = &compositor->workers[used_tiles % compositor->worker_count];
+        worker->tasks[COMPOSITOR_TAIL(worker->task_range)] = tile;
+        worker->task_range = COMPOSITOR_RANGE(0, COMPOSITOR_TAIL(worker->task_range) + 1);
+        used_tiles++;
+    }
+
+    //Not worth waking anyone up for
+    if(used_tiles < 2)
+        return 0;
+
+    //The tiles cover everything, so nothing in them needs catching up
+    Window_mark_current(window, dirty_region);
+
+    //Start the job and do our share of it. If overdraw is being tracked,
+    //everyone counts into the same map, which is fine since tiles don't overlap
+    compositor->paint_window = window;
+
+    //With a swap chain the screen's buffer changes every frame, so workers
+    //need pointing at the current one too
+    for(i = 0; i < compositor->worker_count; i++) {
+
+        compositor->workers[i].context->buffer = compositor->context->buffer;
+        compositor->workers[i].context->write_counts = compositor->context->write_counts;
+    }
+
+    pthread_mutex_lock(&compositor->lock);
+    compositor->busy_workers = compositor->worker_count - 1;
+    compositor->generation++;
+    pthread_cond_broadcast(&compositor->start_condition);
+    pthread_mutex_unlock(&compositor->lock);
+
+    Compositor_run_tasks(&compositor->workers[0]);
+
+    pthread_mutex_lock(&compositor->lock);
+
+    while(compositor->busy_workers)
+        pthread_cond_wait(&compositor->done_condition, &compositor->lock);
+
+    pthread_mutex_unlock(&compositor->lock);
+
+    //Collect what everyone drew into the screen's damage and counters
+    for(i = 0; i < compositor->worker_count; i++) {
+
+        worker_context = compositor->workers[i].context;
+
+        for(j = 0; j < worker_context->damage_count; j++)
+            Context_add_damage(compositor->context, &worker_context->damage_rects[j]);
+
+        Context_clear_damage(worker_context);
+
+        Context_merge_stats(compositor->context, worker_context);
+        worker_context->write_counts = (uint8_t*)0;
+    }
+
+    return 1;
+}
@@ -0,0 +1,58 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include "context.h"
+#include "region.h"
+#include "window.h"
+
+//================| Compositor Class Declaration |================//
+
+//An optional helper that spreads big repaints over several threads. The
+//screen is cut into fixed tiles, and a repaint becomes one task per tile
+//that the repaint touches: paint the window tree with the dirty region
+//limited to that tile. Every thread paints through its own Context (so it
+//has its own clipping state and translation) into the shared framebuffer,
+//and since the tiles never overlap no two threads ever write the same pixel.
+//
+//Tasks are dealt out round-robin into a deque per thread up front. A thread
+//works through its own deque from the front, and once it runs dry it steals
+//from the back of the others'. Both ends of a deque live in one word that
+//is only ever changed with compare-and-swap, so none of it needs a lock
+
+//Tiles are this many pixels on a side
+#define COMPOSITOR_TILE_SIZE 128
+
+struct Compositor_struct;
+
+typedef struct CompositorWorker_struct {
+    struct Compositor_struct* compositor;
+    pthread_t thread;
+    Context* context; //This worker's private view of the screen
+    int* tasks; //Tile indices, owned from the front and stolen from the back
+    uint64_t task_range; //Low half is the next task's index, high half one past the last
+} CompositorWorker;
+
+typedef struct Compositor_struct {
+    Context* context; //The screen context being painted into
+    int worker_count; //Including the calling thread, which does its share
+    CompositorWorker* workers;
+    int tile_columns;
+    int tile_rows;
+    Region** tile_dirty; //Per-tile area to repaint in the current job
+    Window* paint_window; //What the current job is painting
+    pthread_mutex_t lock;
+    pthread_cond_t start_condition;
+    pthread_cond_t done_condition;
+    unsigned int generation; //Bumped to start each job
+    int busy_workers;
+    uint8_t quitting;
+} Compositor;
+
+//Methods
+Compositor* Compositor_new(Context* context, int thread_count);
+void Compositor_delete(Compositor* compositor);
+int Compositor_paint(Compositor* compositor, Window* window, Region* dirty_region);
+
+#endif //COMPOSITOR_H
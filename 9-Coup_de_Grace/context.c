@@ -1,47 +1,459 @@
 #include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
 #include "context.h"
 #include "rect.h"
+#include "span.h"
 #include "font.h"
+#include "displaylist.h"
 
 
 //================| Context Class Implementation |================//
 
+//Our font is 8x12 and covers the core set of 128 ASCII chars
+#define FONT_WIDTH 8
+#define FONT_HEIGHT 12
+#define FONT_CHARS 128
+
+//The font as stored in font.h keeps the same row of every character
+//together, so the rows of any one glyph sit 128 bytes apart. At startup we
+//rearrange it so that each glyph's rows are contiguous, and expand every
+//1bpp row into eight ready-to-use pixel masks (all-ones where the pixel is
+//set) that the span kernels can blit in one go. The padding at the end lets
+//the kernels load a full eight masks from any starting column
+uint8_t glyph_rows[FONT_CHARS][FONT_HEIGHT];
+Pixel glyph_masks[(FONT_CHARS * FONT_HEIGHT * FONT_WIDTH) + FONT_WIDTH];
+uint8_t glyph_cache_built = 0;
+
+void Context_build_glyph_cache(void) {
+
+    int character, font_y, font_x;
+    uint8_t line;
+
+    if(glyph_cache_built)
+        return;
+
+    for(character = 0; character < FONT_CHARS; character++) {
+
+        for(font_y = 0; font_y < FONT_HEIGHT; font_y++) {
+
+            line = font_array[font_y * FONT_CHARS + character];
+            glyph_rows[character][font_y] = line;
+
+            //Leftmost pixel is the high bit
+            for(font_x = 0; font_x < FONT_WIDTH; font_x++, line <<= 1)
+                glyph_masks[(((character * FONT_HEIGHT) + font_y) * FONT_WIDTH) + font_x] =
+                    (line & 0x80) ? (Pixel)~0 : 0;
+        }
+    }
+
+    glyph_cache_built = 1;
+}
+
+//While a thread is helping the compositor paint, everything it draws on the
+//screen context goes through a private context of its own instead, so that
+//each thread gets its own clipping and translation. These are per-thread, so
+//any other thread using the same screen context is unaffected
+__thread Context* thread_screen_context = (Context*)0;
+__thread Context* thread_target_context = (Context*)0;
+
+//Redirect this thread's drawing on screen into target, or stop redirecting
+//if both are null
+void Context_set_thread_target(Context* screen, Context* target) {
+
+    thread_screen_context = screen;
+    thread_target_context = target;
+}
+
+//The context this thread should really be using when asked to draw on the
+//passed one
+Context* Context_for_thread(Context* context) {
+
+    return context == thread_screen_context ? thread_target_context : context;
+}
+
 //Constructor for our context
-Context* Context_new(uint16_t width, uint16_t height, uint32_t* buffer) {
+Context* Context_new(uint16_t width, uint16_t height, Pixel* buffer) {
 
     //Attempt to allocate
     Context* context;
     if(!(context = (Context*)malloc(sizeof(Context))))
         return context; 
 
-    //Attempt to allocate new rect list 
-    if(!(context->clip_rects = List_new())) {
+    //Make sure we're using the best pixel routines this machine has
+    //and that the font is ready for them
+    Span_init();
+    Context_build_glyph_cache();
+
+    //Attempt to allocate the clipping region
+    if(!(context->clip_region = Region_new())) {
 
         free(context);
         return (Context*)0;
     }
 
+    //And the scratch memory used while painting
+    if(!(context->frame_arena = Arena_new(CONTEXT_FRAME_ARENA_SIZE))) {
+
+        Region_delete(context->clip_region);
+        free(context);
+        return (Context*)0;
+    }
+
     //Finish assignments
     context->width = width; 
     context->height = height; 
     context->buffer = buffer;
+    context->translate_x = 0;
+    context->translate_y = 0;
     context->clipping_on = 0;
+    context->damage_count = 0;
+    context->compositor = (struct Compositor_struct*)0;
+    context->recording = (DisplayList*)0;
+    context->write_counts = (uint8_t*)0;
+    context->paint_log = (Region*)0;
+    context->offscreen = 0;
+    context->batch_depth = 0;
+    context->batch_count = 0;
+    context->mask_threshold = CONTEXT_MASK_THRESHOLD;
+    context->batch_threshold = CONTEXT_BATCH_THRESHOLD;
+    context->clip_mask = (uint8_t*)0;
+    context->clip_mask_size = 0;
+    context->clip_mask_stride = 0;
+    context->clip_mask_valid = 0;
+    context->stale_region = (Region*)0;
+    context->stale_source = (Pixel*)0;
+    context->caught_up_pixels = 0;
+    Context_reset_stats(context);
 
     return context;
 }
 
-void Context_clipped_rect(Context* context, int x, int y, unsigned int width,
-                          unsigned int height, Rect* clip_area, uint32_t color) {
+//Make a context with a framebuffer of its own that isn't on the screen, to
+//be drawn into alongside the screen context during the same events. It
+//uses the screen's frame arena rather than having its own, so that the
+//scratch memory gets released when the screen's does
+Context* Context_new_offscreen(Context* screen, uint16_t width, uint16_t height) {
 
-    int cur_x;
-    int max_x = x + width;
-    int max_y = y + height;
+    Context* context;
+    Pixel* buffer;
 
-    //Translate the rectangle coordinates by the context translation values
-    x += context->translate_x;
-    y += context->translate_y;
-    max_x += context->translate_x;
-    max_y += context->translate_y;
+    if(!(buffer = (Pixel*)malloc(sizeof(Pixel) * width * height)))
+        return (Context*)0;
+
+    if(!(context = Context_new(width, height, buffer))) {
+
+        free(buffer);
+        return context;
+    }
+
+    Arena_delete(context->frame_arena);
+    context->frame_arena = screen->frame_arena;
+    context->offscreen = 1;
+
+    return context;
+}
+
+//Make a context for a compositor thread to paint the screen with. Whatever
+//a paint allocates comes out of the screen context's frame arena (windows
+//only ever see the screen context), so one of its own would never get used
+Context* Context_new_worker(Context* screen) {
+
+    Context* context;
+
+    if(!(context = Context_new(screen->width, screen->height, screen->buffer)))
+        return context;
+
+    Arena_delete(context->frame_arena);
+    context->frame_arena = (Arena*)0;
+
+    return context;
+}
+
+//Free a context, but not the framebuffer it draws into, which belongs to
+//whoever created it (unless that was us, for an offscreen context)
+void Context_delete(Context* context) {
+
+    free(context->write_counts);
+    free(context->clip_mask);
+    Region_delete(context->clip_region);
+
+    if(context->offscreen)
+        free(context->buffer);
+    else if(context->frame_arena)
+        Arena_delete(context->frame_arena);
+
+    free(context);
+}
+
+//Start or stop keeping track of how many times each pixel gets written, so
+//that overdraw can be counted. Returns zero if there wasn't enough memory
+int Context_track_overdraw(Context* context, int enable) {
+
+    free(context->write_counts);
+    context->write_counts = (uint8_t*)0;
+
+    if(!enable)
+        return 1;
+
+    if(!(context->write_counts = (uint8_t*)malloc(context->width * context->height)))
+        return 0;
+
+    memset(context->write_counts, 0, context->width * context->height);
+
+    return 1;
+}
+
+//Start counting from zero again, including overdraw
+void Context_reset_stats(Context* context) {
+
+    context->stats.pixels_written = 0;
+    context->stats.overdraw = 0;
+    context->stats.clip_rects_processed = 0;
+    context->stats.clip_rects_split = 0;
+    context->stats.clip_rects_created = 0;
+    context->stats.paint_calls = 0;
+    context->stats.windows_painted = 0;
+
+    if(context->write_counts)
+        memset(context->write_counts, 0, context->width * context->height);
+}
+
+//Add the other context's totals to this one's and zero them, as when
+//collecting up what a compositor thread did
+void Context_merge_stats(Context* context, Context* other) {
+
+    context->stats.pixels_written += other->stats.pixels_written;
+    context->stats.overdraw += other->stats.overdraw;
+    context->stats.clip_rects_processed += other->stats.clip_rects_processed;
+    context->stats.clip_rects_split += other->stats.clip_rects_split;
+    context->stats.clip_rects_created += other->stats.clip_rects_created;
+    context->stats.paint_calls += other->stats.paint_calls;
+    context->stats.windows_painted += other->stats.windows_painted;
+
+    other->stats.pixels_written = 0;
+    other->stats.overdraw = 0;
+    other->stats.clip_rects_processed = 0;
+    other->stats.clip_rects_split = 0;
+    other->stats.clip_rects_created = 0;
+    other->stats.paint_calls = 0;
+    other->stats.windows_painted = 0;
+}
+
+//Note that a run of count pixels starting at dest is being written, or
+//just the ones with their mask set if there is a mask
+void Context_count_writes(Context* context, Pixel* dest, Pixel* mask, unsigned int count) {
+
+    unsigned int i;
+    uint8_t* write_count = context->write_counts + (dest - context->buffer);
+
+    for(i = 0; i < count; i++) {
+
+        if(mask && !mask[i])
+            continue;
+
+        if(write_count[i])
+            context->stats.overdraw++;
+
+        //Saturate rather than wrap back around to zero
+        if(write_count[i] < 255)
+            write_count[i]++;
+    }
+}
+
+//The same as Context_count_writes, for a run of pixels with a mask of bits
+//(see Span_fill_bits)
+void Context_count_bit_writes(Context* context, Pixel* dest, uint8_t* bits,
+                              unsigned int first_bit, unsigned int count) {
+
+    unsigned int i, bit;
+    uint8_t* write_count = context->write_counts + (dest - context->buffer);
+
+    for(i = 0; i < count; i++) {
+
+        bit = first_bit + i;
+
+        if(!(bits[bit >> 3] & (0x80 >> (bit & 7))))
+            continue;
+
+        if(write_count[i])
+            context->stats.overdraw++;
+
+        if(write_count[i] < 255)
+            write_count[i]++;
+    }
+}
+
+//Set bits first through last (inclusive) of a row of a clip mask
+void Context_set_mask_bits(uint8_t* row, int first, int last) {
+
+    for(; first <= last && (first & 7); first++)
+        row[first >> 3] |= 0x80 >> (first & 7);
+
+    if(last - first + 1 >= 8) {
+
+        memset(row + (first >> 3), 0xFF, (last - first + 1) >> 3);
+        first += (last - first + 1) & ~7;
+    }
+
+    for(; first <= last; first++)
+        row[first >> 3] |= 0x80 >> (first & 7);
+}
+
+//When a window is covered by lots of others, its clip region can end up cut
+//into so many slivers that drawing anything means clipping it against
+//dozens of rects, each with its own little fill. Past mask_threshold rects
+//we instead draw the region into a bitmap with one bit per pixel, and run
+//each fill or glyph over it in a single pass no matter how many rects it
+//crosses (see Span_fill_bits). The mask only covers the part of the
+//region's extents that's on screen, with a spare byte at the end of each
+//row for the span kernels. Each band only has to be drawn into the mask
+//once and then copied down the rest of its rows.
+//Returns zero if there wasn't enough memory for it
+int Context_build_clip_mask(Context* context) {
+
+    int i, k, end, top, bottom, first, last;
+    unsigned int size;
+    uint8_t* row;
+    Region* clip_region = context->clip_region;
+    Rect* bounds = &context->clip_mask_bounds;
+
+    bounds->top = clip_region->extents.top < 0 ? 0 : clip_region->extents.top;
+    bounds->left = clip_region->extents.left < 0 ? 0 : clip_region->extents.left;
+    bounds->bottom = clip_region->extents.bottom >= context->height ?
+                     context->height - 1 : clip_region->extents.bottom;
+    bounds->right = clip_region->extents.right >= context->width ?
+                    context->width - 1 : clip_region->extents.right;
+
+    //Nothing on screen, so every fill will miss the bounds anyhow
+    if(bounds->top > bounds->bottom || bounds->left > bounds->right) {
+
+        context->clip_mask_valid = 1;
+        return 1;
+    }
+
+    context->clip_mask_stride = ((bounds->right - bounds->left + 1 + 7) >> 3) + 1;
+    size = context->clip_mask_stride * (bounds->bottom - bounds->top + 1);
+
+    if(size > context->clip_mask_size) {
+
+        free(context->clip_mask);
+        context->clip_mask_size = 0;
+
+        if(!(context->clip_mask = (uint8_t*)malloc(size)))
+            return 0;
+
+        context->clip_mask_size = size;
+    }
+
+    memset(context->clip_mask, 0, size);
+
+    for(i = 0; i < clip_region->count; i = end) {
+
+        for(end = i + 1; end < clip_region->count &&
+            clip_region->rects[end].top == clip_region->rects[i].top; end++);
+
+        top = clip_region->rects[i].top < bounds->top ? bounds->top : clip_region->rects[i].top;
+        bottom = clip_region->rects[i].bottom > bounds->bottom ?
+                 bounds->bottom : clip_region->rects[i].bottom;
+
+        if(top > bottom)
+            continue;
+
+        row = context->clip_mask + ((top - bounds->top) * context->clip_mask_stride);
+
+        for(k = i; k < end; k++) {
+
+            first = clip_region->rects[k].left < bounds->left ?
+                    bounds->left : clip_region->rects[k].left;
+            last = clip_region->rects[k].right > bounds->right ?
+                   bounds->right : clip_region->rects[k].right;
+
+            if(first <= last)
+                Context_set_mask_bits(row, first - bounds->left, last - bounds->left);
+        }
+
+        for(top++; top <= bottom; top++)
+            memcpy(context->clip_mask + ((top - bounds->top) * context->clip_mask_stride),
+                   row, context->clip_mask_stride);
+    }
+
+    context->clip_mask_valid = 1;
+
+    return 1;
+}
+
+//Whether drawing should go through the clip mask rather than the clip
+//region's rects, building the mask first if it's out of date. If there
+//isn't enough memory for it we just keep on using the rects
+int Context_use_clip_mask(Context* context) {
+
+    if(context->clip_region->count <= context->mask_threshold)
+        return 0;
+
+    if(context->clip_mask_valid)
+        return 1;
+
+    return Context_build_clip_mask(context);
+}
+
+//Fill a rect, in screen coordinates, through the clip mask
+void Context_fill_masked(Context* context, Rect* rect, Pixel color) {
+
+    int i, bit, x, y, max_x, max_y, first_bit;
+    unsigned long filled = 0;
+    Pixel* dest;
+    uint8_t* bits;
+    Rect* bounds = &context->clip_mask_bounds;
+
+    x = rect->left < bounds->left ? bounds->left : rect->left;
+    y = rect->top < bounds->top ? bounds->top : rect->top;
+    max_x = rect->right > bounds->right ? bounds->right + 1 : rect->right + 1;
+    max_y = rect->bottom > bounds->bottom ? bounds->bottom + 1 : rect->bottom + 1;
+
+    context->stats.clip_rects_processed++;
+
+    if(x >= max_x || y >= max_y)
+        return;
+
+    dest = context->buffer + (y * context->width) + x;
+    bits = context->clip_mask + ((y - bounds->top) * context->clip_mask_stride);
+    first_bit = x - bounds->left;
+
+    for(; y < max_y; y++, dest += context->width, bits += context->clip_mask_stride) {
+
+        //Same as in Span_fill_rect, skinny rects (lines and borders, mostly)
+        //are quicker to do right here than by calling a kernel for every row
+        if(max_x - x < SPAN_MIN_KERNEL_WIDTH) {
+
+            for(i = 0, bit = first_bit; i < max_x - x; i++, bit++) {
+
+                if(bits[bit >> 3] & (0x80 >> (bit & 7))) {
+
+                    dest[i] = color;
+                    filled++;
+                }
+            }
+        } else {
+
+            filled += Span_fill_bits(dest, color, bits, first_bit, max_x - x);
+        }
+
+        if(context->write_counts)
+            Context_count_bit_writes(context, dest, bits, first_bit, max_x - x);
+    }
+
+    context->stats.pixels_written += filled;
+}
+
+//Fill the part of a rect, in screen coordinates, inside of one clipping rect
+void Context_fill_clipped(Context* context, Rect* rect, Rect* clip_area, Pixel color) {
+
+    int i;
+    int x = rect->left;
+    int y = rect->top;
+    int max_x = rect->right + 1;
+    int max_y = rect->bottom + 1;
 
     //Make sure we don't go outside of the clip region:
     if(x < clip_area->left)
@@ -56,11 +468,371 @@ void Context_clipped_rect(Context* context, int x, int y, unsigned int width,
     if(max_y > clip_area->bottom + 1)
         max_y = clip_area->bottom + 1;
 
+    context->stats.clip_rects_processed++;
+
+    if(x >= max_x || y >= max_y)
+        return;
+
+    context->stats.pixels_written += (max_x - x) * (max_y - y);
+
+    if(context->write_counts)
+        for(i = y; i < max_y; i++)
+            Context_count_writes(context, context->buffer + (i * context->width) + x,
+                                 (Pixel*)0, max_x - x);
+
     //Draw the rectangle into the framebuffer line-by line
-    //(bonus points if you write an assembly routine to do it faster)
-    for(; y < max_y; y++) 
-        for(cur_x = x; cur_x < max_x; cur_x++) 
-            context->buffer[y * context->width + cur_x] = color;
+    //(the span kernels are our 'assembly routine', see span.c)
+    Span_fill_rect(context->buffer + (y * context->width) + x, context->width,
+                   color, max_x - x, max_y - y);
+}
+
+void Context_clipped_rect(Context* context, int x, int y, unsigned int width,
+                          unsigned int height, Rect* clip_area, Pixel color) {
+
+    Rect rect;
+    int max_x = x + width;
+    int max_y = y + height;
+
+    //Translate the rectangle coordinates by the context translation values
+    rect.top = y + context->translate_y;
+    rect.left = x + context->translate_x;
+    rect.bottom = max_y + context->translate_y - 1;
+    rect.right = max_x + context->translate_x - 1;
+
+    Context_fill_clipped(context, &rect, clip_area, color);
+}
+
+//Draw everything in the batch. Rather than walking the clip region once
+//per fill, we walk it once for the whole batch, a band at a time, and draw
+//every fill that touches each band while we're there. That way each band's
+//rows of the framebuffer only need to be brought into the cache once.
+//Within a clip rect the fills still go in the order they were made, and
+//clip rects never overlap, so what ends up on screen is the same either way
+void Context_flush_batch(Context* context) {
+
+    int i, j, k, end, top, bottom;
+    Rect *clip_area, *rect;
+    Rect screen_area;
+    Region* clip_region = context->clip_region;
+
+    if(!context->batch_count)
+        return;
+
+    if(!clip_region->count) {
+
+        //No clipping rects means the whole screen, unless clipping is on
+        //and everything has been clipped away
+        if(!context->clipping_on) {
+
+            screen_area.top = 0;
+            screen_area.left = 0;
+            screen_area.bottom = context->height - 1;
+            screen_area.right = context->width - 1;
+
+            for(j = 0; j < context->batch_count; j++)
+                Context_fill_clipped(context, &context->batch_rects[j],
+                                     &screen_area, context->batch_colors[j]);
+        }
+
+        context->batch_count = 0;
+        return;
+    }
+
+    //The clip mask takes care of every clip rect at once, so there's no
+    //need to walk the region at all
+    if(Context_use_clip_mask(context)) {
+
+        for(j = 0; j < context->batch_count; j++)
+            Context_fill_masked(context, &context->batch_rects[j], context->batch_colors[j]);
+
+        context->batch_count = 0;
+        return;
+    }
+
+    //Only the bands between the top and bottom of the batch can be involved
+    top = context->batch_rects[0].top;
+    bottom = context->batch_rects[0].bottom;
+
+    for(j = 1; j < context->batch_count; j++) {
+
+        if(context->batch_rects[j].top < top)
+            top = context->batch_rects[j].top;
+
+        if(context->batch_rects[j].bottom > bottom)
+            bottom = context->batch_rects[j].bottom;
+    }
+
+    for(i = Region_find_band(clip_region, top);
+        i < clip_region->count && clip_region->rects[i].top <= bottom; i = end) {
+
+        for(end = i + 1; end < clip_region->count &&
+            clip_region->rects[end].top == clip_region->rects[i].top; end++);
+
+        for(j = 0; j < context->batch_count; j++) {
+
+            rect = &context->batch_rects[j];
+
+            if(rect->bottom < clip_region->rects[i].top || rect->top > clip_region->rects[i].bottom)
+                continue;
+
+            //The rects in a band go left to right
+            for(k = i; k < end; k++) {
+
+                clip_area = &clip_region->rects[k];
+
+                if(clip_area->left > rect->right)
+                    break;
+
+                if(clip_area->right >= rect->left)
+                    Context_fill_clipped(context, rect, clip_area, context->batch_colors[j]);
+            }
+        }
+    }
+
+    context->batch_count = 0;
+}
+
+//Until the matching Context_end_batch, fills don't get drawn right away but
+//saved up and drawn all together, see Context_flush_batch (unless the clip
+//region is too simple for that to pay, see CONTEXT_BATCH_THRESHOLD). Anything else
+//that gets drawn, and any change to the clipping, draws the fills saved up
+//so far first so that everything still lands in the right order. Batches
+//can be nested, and only get drawn once the outermost one ends
+void Context_begin_batch(Context* context) {
+
+    context = Context_for_thread(context);
+    context->batch_depth++;
+}
+
+void Context_end_batch(Context* context) {
+
+    context = Context_for_thread(context);
+
+    if(--context->batch_depth)
+        return;
+
+    Context_flush_batch(context);
+}
+
+//Copy a rect of pixels, in screen coordinates, to somewhere else in the
+//framebuffer and mark where it landed as damaged. Clipping and translation
+//don't apply, but anything that would be read from or written to outside of
+//the framebuffer is left out. The source and destination can overlap
+void Context_copy_rect(Context* context, int source_x, int source_y, unsigned int width,
+                       unsigned int height, int dest_x, int dest_y) {
+
+    int i, row;
+    int x_offset = dest_x - source_x;
+    int y_offset = dest_y - source_y;
+    int left = source_x;
+    int top = source_y;
+    int right = source_x + width;
+    int bottom = source_y + height;
+    Pixel* dest;
+    Rect source_rect, dest_rect;
+
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+
+    //Trim the source so that both it and the destination are on screen
+    if(left < 0)
+        left = 0;
+
+    if(left + x_offset < 0)
+        left = -x_offset;
+
+    if(top < 0)
+        top = 0;
+
+    if(top + y_offset < 0)
+        top = -y_offset;
+
+    if(right > context->width)
+        right = context->width;
+
+    if(right + x_offset > context->width)
+        right = context->width - x_offset;
+
+    if(bottom > context->height)
+        bottom = context->height;
+
+    if(bottom + y_offset > context->height)
+        bottom = context->height - y_offset;
+
+    if(left >= right || top >= bottom)
+        return;
+
+    dest_rect.top = top + y_offset;
+    dest_rect.left = left + x_offset;
+    dest_rect.bottom = bottom + y_offset - 1;
+    dest_rect.right = right + x_offset - 1;
+
+    //With a swap chain, the source has to be caught up before it's read,
+    //while the destination is about to be replaced outright
+    if(context->stale_region) {
+
+        source_rect.top = top;
+        source_rect.left = left;
+        source_rect.bottom = bottom - 1;
+        source_rect.right = right - 1;
+        Context_catch_up(context, &source_rect);
+
+        if(!Region_subtract_rect(context->stale_region, &dest_rect))
+            Context_catch_up_all(context);
+    }
+
+    //When copying downwards, start from the bottom so that no row gets
+    //copied over before it's been read. memmove takes care of sideways
+    for(i = 0; i < bottom - top; i++) {
+
+        row = y_offset > 0 ? bottom - 1 - i : top + i;
+        dest = context->buffer + ((row + y_offset) * context->width) + left + x_offset;
+        memmove(dest, context->buffer + (row * context->width) + left,
+                sizeof(Pixel) * (right - left));
+
+        if(context->write_counts)
+            Context_count_writes(context, dest, (Pixel*)0, right - left);
+    }
+
+    context->stats.pixels_written += (right - left) * (bottom - top);
+    Context_add_damage(context, &dest_rect);
+}
+
+//Copy the rects of one band of a region, going against the direction of
+//the copy so that no rect gets copied over before it's been read
+void Context_copy_band(Context* context, Region* region, int start, int end, int x, int y) {
+
+    int i;
+    Rect* rect;
+
+    for(i = 0; i < end - start; i++) {
+
+        rect = &region->rects[x > 0 ? end - 1 - i : start + i];
+        Context_copy_rect(context, rect->left, rect->top, rect->right - rect->left + 1,
+                          rect->bottom - rect->top + 1, rect->left + x, rect->top + y);
+    }
+}
+
+//Move the pixels inside of a region (in screen coordinates) over by x, y
+void Context_copy_region(Context* context, Region* region, int x, int y) {
+
+    int start, end;
+    Rect* rects = region->rects;
+
+    //Same idea as for a single rect: bands get done bottom to top when
+    //copying downwards, and top to bottom otherwise
+    if(y > 0) {
+
+        for(end = region->count; end > 0; end = start) {
+
+            for(start = end - 1; start > 0 && rects[start - 1].top == rects[end - 1].top; start--);
+
+            Context_copy_band(context, region, start, end, x, y);
+        }
+    } else {
+
+        for(start = 0; start < region->count; start = end) {
+
+            for(end = start + 1; end < region->count && rects[end].top == rects[start].top; end++);
+
+            Context_copy_band(context, region, start, end, x, y);
+        }
+    }
+}
+
+//Copy the part of the source context's pixels that lands inside of one
+//clipping rect, with the source's top-left corner at screen x, y
+void Context_blit_clipped(Context* context, Context* source, int x, int y, Rect* clip_area) {
+
+    int row;
+    int left = x;
+    int top = y;
+    int right = x + source->width;
+    int bottom = y + source->height;
+    Pixel* dest;
+
+    if(left < clip_area->left)
+        left = clip_area->left;
+
+    if(top < clip_area->top)
+        top = clip_area->top;
+
+    if(right > clip_area->right + 1)
+        right = clip_area->right + 1;
+
+    if(bottom > clip_area->bottom + 1)
+        bottom = clip_area->bottom + 1;
+
+    //And never off of the screen
+    if(left < 0)
+        left = 0;
+
+    if(top < 0)
+        top = 0;
+
+    if(right > context->width)
+        right = context->width;
+
+    if(bottom > context->height)
+        bottom = context->height;
+
+    context->stats.clip_rects_processed++;
+
+    if(left >= right || top >= bottom)
+        return;
+
+    context->stats.pixels_written += (right - left) * (bottom - top);
+
+    for(row = top; row < bottom; row++) {
+
+        dest = context->buffer + (row * context->width) + left;
+        memcpy(dest, source->buffer + ((row - y) * source->width) + left - x,
+               sizeof(Pixel) * (right - left));
+
+        if(context->write_counts)
+            Context_count_writes(context, dest, (Pixel*)0, right - left);
+    }
+}
+
+//Copy all of the source context's pixels into this one with their top-left
+//corner at x, y, through our clipping and translation like any other
+//drawing. As with the fills, adding the damage is up to the caller
+void Context_blit(Context* context, Context* source, int x, int y) {
+
+    int i;
+    Rect* clip_area;
+    Rect screen_area;
+
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    x += context->translate_x;
+    y += context->translate_y;
+
+    screen_area.top = 0;
+    screen_area.left = 0;
+    screen_area.bottom = context->height - 1;
+    screen_area.right = context->width - 1;
+
+    if(!context->clip_region->count) {
+
+        if(!context->clipping_on)
+            Context_blit_clipped(context, source, x, y, &screen_area);
+
+        return;
+    }
+
+    //Only the bands between our top and bottom can be involved
+    for(i = Region_find_band(context->clip_region, y);
+        i < context->clip_region->count &&
+        context->clip_region->rects[i].top < y + source->height; i++) {
+
+        clip_area = &context->clip_region->rects[i];
+
+        if(clip_area->right < x || clip_area->left >= x + source->width)
+            continue;
+
+        Context_blit_clipped(context, source, x, y, clip_area);
+    }
 }
 
 //Simple for-loop rectangle into a context
@@ -69,9 +841,22 @@ void Context_fill_rect(Context* context, int x, int y,
 
     int max_x = x + width;
     int max_y = y + height;
-    int i;
+    int i, screen_x, screen_max_x, screen_max_y;
+    Pixel pixel;
     Rect* clip_area;
     Rect screen_area;
+    Rect screen_rect;
+
+    context = Context_for_thread(context);
+
+    if(context->recording) {
+
+        DisplayList_add_rect(context->recording, DISPLAY_FILL_RECT, x, y, width, height, color);
+        return;
+    }
+
+    //Display lists keep the color, but from here on down it's a pixel
+    pixel = Pixel_from_color(color);
 
     //Fix from last time: Make sure we don't try to draw offscreen
     if(max_x > context->width)
@@ -89,14 +874,59 @@ void Context_fill_rect(Context* context, int x, int y,
     width = max_x - x;
     height = max_y - y;    
 
-    //If there are clipping rects, draw the rect clipped to
-    //each of them. Otherwise, draw unclipped (clipped to the screen)
-    if(context->clip_rects->count) {
-       
-        for(i = 0; i < context->clip_rects->count; i++) {    
+    //Save it for later if we're batching and it's worth it, once it's been
+    //moved to where it goes on screen (since the translation might change
+    //before then). Any fills already saved were saved under the same clip
+    //region, since changing it draws them
+    if(context->batch_depth && context->clip_region->count > context->batch_threshold) {
+
+        if(x >= max_x || y >= max_y)
+            return;
+
+        if(context->batch_count == CONTEXT_MAX_BATCH)
+            Context_flush_batch(context);
+
+        context->batch_rects[context->batch_count].top = y + context->translate_y;
+        context->batch_rects[context->batch_count].left = x + context->translate_x;
+        context->batch_rects[context->batch_count].bottom = max_y + context->translate_y - 1;
+        context->batch_rects[context->batch_count].right = max_x + context->translate_x - 1;
+        context->batch_colors[context->batch_count++] = pixel;
+        return;
+    }
+
+    //If there are clipping rects, draw the rect clipped to each of the
+    //ones it touches. Otherwise, draw unclipped (clipped to the screen)
+    if(context->clip_region->count) {
+
+        //The clip region is in screen space
+        screen_x = x + context->translate_x;
+        screen_max_x = max_x + context->translate_x - 1;
+        screen_max_y = max_y + context->translate_y - 1;
+
+        if(Context_use_clip_mask(context)) {
+
+            if(x >= max_x || y >= max_y)
+                return;
+
+            screen_rect.top = y + context->translate_y;
+            screen_rect.left = screen_x;
+            screen_rect.bottom = screen_max_y;
+            screen_rect.right = screen_max_x;
+            Context_fill_masked(context, &screen_rect, pixel);
+            return;
+        }
+
+        //Only the bands between our top and bottom can be involved
+        for(i = Region_find_band(context->clip_region, y + context->translate_y);
+            i < context->clip_region->count &&
+            context->clip_region->rects[i].top <= screen_max_y; i++) {
+
+            clip_area = &context->clip_region->rects[i];
+
+            if(clip_area->right < screen_x || clip_area->left > screen_max_x)
+                continue;
 
-            clip_area = (Rect*)List_get_at(context->clip_rects, i);
-            Context_clipped_rect(context, x, y, width, height, clip_area, color);
+            Context_clipped_rect(context, x, y, width, height, clip_area, pixel);
         }
     } else {
 
@@ -106,11 +936,27 @@ void Context_fill_rect(Context* context, int x, int y,
             screen_area.left = 0;
             screen_area.bottom = context->height - 1;
             screen_area.right = context->width - 1;
-            Context_clipped_rect(context, x, y, width, height, &screen_area, color);
+            Context_clipped_rect(context, x, y, width, height, &screen_area, pixel);
         }
     }
 }
 
+//Fill a whole list of rects (top, left, bottom and right, like any other
+//Rect) in one batch, each in its own color
+void Context_fill_rects(Context* context, Rect* rects, uint32_t* colors, int count) {
+
+    int i;
+
+    Context_begin_batch(context);
+
+    for(i = 0; i < count; i++)
+        Context_fill_rect(context, rects[i].left, rects[i].top,
+                          rects[i].right - rects[i].left + 1,
+                          rects[i].bottom - rects[i].top + 1, colors[i]);
+
+    Context_end_batch(context);
+}
+
 //A horizontal line as a filled rect of height 1
 void Context_horizontal_line(Context* context, int x, int y,
                              unsigned int length, uint32_t color) {
@@ -129,196 +975,294 @@ void Context_vertical_line(Context* context, int x, int y,
 void Context_draw_rect(Context* context, int x, int y, 
                        unsigned int width, unsigned int height, uint32_t color) {
 
+    context = Context_for_thread(context);
+
+    //Record the outline as a whole rather than as its four sides
+    if(context->recording) {
+
+        DisplayList_add_rect(context->recording, DISPLAY_DRAW_RECT, x, y, width, height, color);
+        return;
+    }
+
+    //All four sides go through the clip region together
+    Context_begin_batch(context);
     Context_horizontal_line(context, x, y, width, color); //top
     Context_vertical_line(context, x, y + 1, height - 2, color); //left 
     Context_horizontal_line(context, x, y + height - 1, width, color); //bottom
     Context_vertical_line(context, x + width - 1, y + 1, height - 2, color); //right
+    Context_end_batch(context);
 }
 
-//Update the clipping rectangles to only include those areas within both the
+//Update the clipping region to only include those areas within both the
 //existing clipping region AND the passed Rect
 void Context_intersect_clip_rect(Context* context, Rect* rect) {
 
-    int i;
-    List* output_rects;
-    Rect* current_rect;
-    Rect* intersect_rect;
- 
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
+
     context->clipping_on = 1;
+    Region_intersect_rect(context->clip_region, rect);
+}
 
-    if(!(output_rects = List_new()))
-        return;
+//Cut the passed rect out of the clipping region
+void Context_subtract_clip_rect(Context* context, Rect* subtracted_rect) {
 
-    for(i = 0; i < context->clip_rects->count; i++) {
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
 
-        current_rect = (Rect*)List_get_at(context->clip_rects, i);
-        intersect_rect = Rect_intersect(current_rect, rect);
+    context->clipping_on = 1;
+    Context_subtract_region_rect(context, context->clip_region, subtracted_rect);
+}
 
-        if(intersect_rect)
-            List_add(output_rects, intersect_rect);
-    }
+//Cut a rect out of a region used for clipping on this context, counting
+//how many of the region's rects got cut into and how many pieces they left
+//behind. The context can be null, in which case nothing gets counted
+//Returns zero if we ran out of memory
+int Context_subtract_region_rect(Context* context, Region* region, Rect* rect) {
 
-    //Delete the original rectangle list
-    while(context->clip_rects->count)
-        free(List_remove_at(context->clip_rects, 0));
-    free(context->clip_rects);
+    int i, ok, created;
+    int split = 0;
+    int old_count = region->count;
 
-    //And re-point it to the new one we built above
-    context->clip_rects = output_rects;
+    if(!context)
+        return Region_subtract_rect(region, rect);
 
-    //Free the input rect
-    free(rect);
-}
+    context = Context_for_thread(context);
 
-//split all existing clip rectangles against the passed rect
-void Context_subtract_clip_rect(Context* context, Rect* subtracted_rect) {
+    for(i = Region_find_band(region, rect->top);
+        i < region->count && region->rects[i].top <= rect->bottom; i++)
+        if(region->rects[i].right >= rect->left && region->rects[i].left <= rect->right)
+            split++;
 
-    //Check each item already in the list to see if it overlaps with
-    //the new rectangle
-    int i, j;
-    Rect* cur_rect;
-    List* split_rects;
+    ok = Region_subtract_rect(region, rect);
 
-    context->clipping_on = 1;
+    //Untouched rects can get merged together too, which could make
+    //this look negative
+    created = region->count - (old_count - split);
+    context->stats.clip_rects_split += split;
+    context->stats.clip_rects_created += created > 0 ? created : 0;
 
-    for(i = 0; i < context->clip_rects->count; ) {
+    return ok;
+}
 
-        cur_rect = List_get_at(context->clip_rects, i);
+//Grow the clipping region to also cover the passed rect
+void Context_add_clip_rect(Context* context, Rect* added_rect) {
 
-        //Standard rect intersect test (if no intersect, skip to next)
-        //see here for an example of why this works:
-        //http://stackoverflow.com/questions/306316/determine-if-two-rectangles-overlap-each-other#tab-top
-        if(!(cur_rect->left <= subtracted_rect->right &&
-		   cur_rect->right >= subtracted_rect->left &&
-		   cur_rect->top <= subtracted_rect->bottom &&
-		   cur_rect->bottom >= subtracted_rect->top)) {
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
 
-            i++;
-            continue;
-        }
+    context->clipping_on = 1;
+    Region_union_rect(context->clip_region, added_rect);
+}
 
-        //If this rectangle does intersect with the new rectangle, 
-        //we need to split it
-        List_remove_at(context->clip_rects, i); //Original will be replaced w/splits
-        split_rects = Rect_split(cur_rect, subtracted_rect); //Do the split
-        free(cur_rect); //We can throw this away now, we're done with it
+//Grow the clipping region to also cover the passed region
+void Context_add_clip_region(Context* context, Region* added_region) {
 
-        //Copy the split, non-overlapping result rectangles into the list 
-        while(split_rects->count) {
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
 
-            cur_rect = (Rect*)List_remove_at(split_rects, 0);
-            List_add(context->clip_rects, cur_rect);
-        }
+    context->clipping_on = 1;
+    Region_union(context->clip_region, context->clip_region, added_region);
+}
 
-        //Free the empty split_rect list 
-        free(split_rects);
+//Replace the clipping region with the passed region, or with just the
+//parts of it that are also in limit_region if that isn't null
+void Context_set_clip_region(Context* context, Region* region, Region* limit_region) {
 
-        //Since we removed an item from the list, we need to start counting over again 
-        //In this way, we'll only exit this loop once nothing in the list overlaps 
-        i = 0;    
-    }
-}
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
 
-void Context_add_clip_rect(Context* context, Rect* added_rect) {
-    
-    Context_subtract_clip_rect(context, added_rect);
+    context->clipping_on = 1;
 
-    //Now that we have made sure none of the existing rectangles overlap
-    //with the new rectangle, we can finally insert it 
-    List_add(context->clip_rects, added_rect);
+    if(limit_region)
+        Region_intersect(context->clip_region, region, limit_region);
+    else
+        Region_copy(context->clip_region, region);
 }
 
 //Remove all of the clipping rects from the passed context object
 void Context_clear_clip_rects(Context* context) {
 
-    Rect* cur_rect;
+    context = Context_for_thread(context);
+    Context_flush_batch(context);
+    context->clip_mask_valid = 0;
 
     context->clipping_on = 0;
-
-    //Remove and free until the list is empty
-    while(context->clip_rects->count) {
-
-        cur_rect = (Rect*)List_remove_at(context->clip_rects, 0);
-        free(cur_rect);
-    }
+    Region_clear(context->clip_region);
 }
 
 //Draw a single character with the specified font color at the specified coordinates
 void Context_draw_char_clipped(Context* context, char character, int x, int y,
-                               uint32_t color, Rect* bound_rect) {
+                               Pixel color, Rect* bound_rect) {
 
     int font_x, font_y;
     int off_x = 0;
     int off_y = 0;
-    int count_x = 8; //Font is 8x12
-    int count_y = 12; 
-    uint8_t shift_line;
+    int count_x = FONT_WIDTH;
+    int count_y = FONT_HEIGHT; 
+    uint8_t line;
+    Pixel* dest;
+    Pixel* mask;
 
     //Make sure to take context translation into account
     x += context->translate_x;
     y += context->translate_y;
 
     //Our font only handles the core set of 128 ASCII chars
-    character &= 0x7F;
+    character &= (FONT_CHARS - 1);
 
     //Check to see if the character is even inside of this rectangle
-    if(x > bound_rect->right || (x + 8) <= bound_rect->left ||
-       y > bound_rect->bottom || (y + 12) <= bound_rect->top)
+    if(x > bound_rect->right || (x + FONT_WIDTH) <= bound_rect->left ||
+       y > bound_rect->bottom || (y + FONT_HEIGHT) <= bound_rect->top)
         return;
 
     //Limit the drawn portion of the character to the interior of the rect
     if(x < bound_rect->left)
         off_x = bound_rect->left - x;        
 
-    if((x + 8) > bound_rect->right)
+    if((x + FONT_WIDTH) > bound_rect->right)
         count_x = bound_rect->right - x + 1;
 
     if(y < bound_rect->top)
         off_y = bound_rect->top - y;
 
-    if((y + 12) > bound_rect->bottom)
+    if((y + FONT_HEIGHT) > bound_rect->bottom)
         count_y = bound_rect->bottom - y + 1;
 
-    //Now we do the actual pixel plotting loop
-    for(font_y = off_y; font_y < count_y; font_y++) {
+    context->stats.clip_rects_processed++;
+
+    //Now we do the actual pixel plotting loop, one masked row at a time
+    //starting from the first visible row and column of the glyph
+    dest = context->buffer + ((y + off_y) * context->width) + x + off_x;
+    mask = glyph_masks + (((character * FONT_HEIGHT) + off_y) * FONT_WIDTH) + off_x;
 
-        //Capture the current line of the specified char
-        //Just a normal bmp[y * width + x], but in this
-        //case we're dealing with an array of 1bpp
-        //8-bit-wide character lines
-        shift_line = font_array[font_y * 128 + character];
+    for(font_y = off_y; font_y < count_y; font_y++, dest += context->width, mask += FONT_WIDTH) {
+
+        //Plenty of rows are blank, so don't bother with those at all
+        if(!glyph_rows[(int)character][font_y])
+            continue;
 
-        //Pre-shift the line by the x-offset
-        shift_line <<= off_x;
+        //Without a vector kernel to hand the masks to, walking eight of
+        //them costs more than just testing the font bits one at a time
+        if(span_mask_kernel == Span_fill_masked_portable) {
 
-        for(font_x = off_x; font_x < count_x; font_x++) {
+            line = (uint8_t)(glyph_rows[(int)character][font_y] << off_x);
 
-            //Get the current leftmost bit of the current 
-            //line of the character and, if it's set, plot a pixel
-            if(shift_line & 0x80)
-                context->buffer[(font_y + y) * context->width + (font_x + x)] = color;
- 
-            //Shift in the next bit
-            shift_line <<= 1; 
+            for(font_x = 0; font_x < count_x - off_x; font_x++, line <<= 1)
+                if(line & 0x80)
+                    dest[font_x] = color;
+        } else {
+
+            Span_fill_masked(dest, color, mask, count_x - off_x);
         }
+
+        context->stats.pixels_written += count_x - off_x;
+
+        if(context->write_counts)
+            Context_count_writes(context, dest, mask, count_x - off_x);
     }
 }
 
-//This will be a lot like Context_fill_rect, but on a bitmap font character
-void Context_draw_char(Context* context, char character, int x, int y, uint32_t color) {
+//Draw a character, at screen coordinates, through the clip mask. Each row
+//of the glyph is already a byte of bits like the mask's, so the two can
+//just be and-ed together and drawn in one go
+void Context_draw_char_masked(Context* context, char character, int x, int y, Pixel color) {
 
-    int i;
+    int font_y, first_bit;
+    int off_x = 0;
+    int off_y = 0;
+    int count_x = FONT_WIDTH;
+    int count_y = FONT_HEIGHT;
+    Pixel* dest;
+    uint8_t* bits;
+    uint8_t clip_bits, drawn_bits[2];
+    Rect* bounds = &context->clip_mask_bounds;
+
+    character &= (FONT_CHARS - 1);
+
+    if(x > bounds->right || (x + FONT_WIDTH) <= bounds->left ||
+       y > bounds->bottom || (y + FONT_HEIGHT) <= bounds->top)
+        return;
+
+    if(x < bounds->left)
+        off_x = bounds->left - x;
+
+    if((x + FONT_WIDTH) > bounds->right)
+        count_x = bounds->right - x + 1;
+
+    if(y < bounds->top)
+        off_y = bounds->top - y;
+
+    if((y + FONT_HEIGHT) > bounds->bottom)
+        count_y = bounds->bottom - y + 1;
+
+    context->stats.clip_rects_processed++;
+
+    dest = context->buffer + ((y + off_y) * context->width) + x + off_x;
+    bits = context->clip_mask + ((y + off_y - bounds->top) * context->clip_mask_stride);
+    first_bit = x + off_x - bounds->left;
+    drawn_bits[1] = 0;
+
+    for(font_y = off_y; font_y < count_y;
+        font_y++, dest += context->width, bits += context->clip_mask_stride) {
+
+        if(!glyph_rows[(int)character][font_y])
+            continue;
+
+        //Count what clipping to rects would have, the part of the row in the clip
+        context->stats.pixels_written += Span_count_bits(bits, first_bit, count_x - off_x);
+
+        clip_bits = (uint8_t)((bits[first_bit >> 3] << (first_bit & 7)) |
+                              (bits[(first_bit >> 3) + 1] >> (8 - (first_bit & 7))));
+        drawn_bits[0] = (uint8_t)(glyph_rows[(int)character][font_y] << off_x) & clip_bits;
+
+        if(!drawn_bits[0])
+            continue;
+
+        Span_fill_bits(dest, color, drawn_bits, 0, count_x - off_x);
+
+        if(context->write_counts)
+            Context_count_bit_writes(context, dest, drawn_bits, 0, count_x - off_x);
+    }
+}
+
+//Draw a character in an already converted color, clipped to whatever the
+//context is clipped to. Everything that only has to happen once per string
+//is left to the caller
+void Context_draw_char_pixel(Context* context, char character, int x, int y, Pixel pixel) {
+
+    int i, screen_x, screen_y;
     Rect* clip_area;
     Rect screen_area;
 
-    //If there are clipping rects, draw the character clipped to
-    //each of them. Otherwise, draw unclipped (clipped to the screen)
-    if(context->clip_rects->count) {
-       
-        for(i = 0; i < context->clip_rects->count; i++) {    
+    //If there are clipping rects, draw the character clipped to each of
+    //the ones it touches. Otherwise, draw unclipped (clipped to the screen)
+    if(context->clip_region->count) {
+
+        screen_x = x + context->translate_x;
+        screen_y = y + context->translate_y;
 
-            clip_area = (Rect*)List_get_at(context->clip_rects, i);
-            Context_draw_char_clipped(context, character, x, y, color, clip_area);
+        if(Context_use_clip_mask(context)) {
+
+            Context_draw_char_masked(context, character, screen_x, screen_y, pixel);
+            return;
+        }
+
+        for(i = Region_find_band(context->clip_region, screen_y);
+            i < context->clip_region->count &&
+            context->clip_region->rects[i].top < screen_y + FONT_HEIGHT; i++) {
+
+            clip_area = &context->clip_region->rects[i];
+
+            if(clip_area->right < screen_x || clip_area->left >= screen_x + FONT_WIDTH)
+                continue;
+
+            Context_draw_char_clipped(context, character, x, y, pixel, clip_area);
         }
     } else {
 
@@ -328,14 +1272,238 @@ void Context_draw_char(Context* context, char character, int x, int y, uint32_t
             screen_area.left = 0;
             screen_area.bottom = context->height - 1;
             screen_area.right = context->width - 1;
-            Context_draw_char_clipped(context, character, x, y, color, clip_area);
+            Context_draw_char_clipped(context, character, x, y, pixel, &screen_area);
         }
     }
 }
 
+//This will be a lot like Context_fill_rect, but on a bitmap font character
+void Context_draw_char(Context* context, char character, int x, int y, uint32_t color) {
+
+    context = Context_for_thread(context);
+
+    if(context->recording) {
+
+        DisplayList_add_text(context->recording, &character, 1, x, y, color);
+        return;
+    }
+
+    Context_flush_batch(context);
+    Context_draw_char_pixel(context, character, x, y, Pixel_from_color(color));
+}
+
 //Draw a line of text with the specified font color at the specified coordinates
 void Context_draw_text(Context* context, char* string, int x, int y, uint32_t color) {
 
+    int length, screen_x, screen_y;
+    Pixel pixel;
+    Rect* extents;
+
+    context = Context_for_thread(context);
+    extents = &context->clip_region->extents;
+
+    if(context->recording) {
+
+        for(length = 0; string[length]; length++);
+        DisplayList_add_text(context->recording, string, length, x, y, color);
+        return;
+    }
+
+    Context_flush_batch(context);
+    pixel = Pixel_from_color(color);
+
+    //Characters that are nowhere near the clip region can be skipped
+    //without looking for clip rects they touch
+    if(context->clip_region->count) {
+
+        screen_x = x + context->translate_x;
+        screen_y = y + context->translate_y;
+
+        if(screen_y > extents->bottom || screen_y + FONT_HEIGHT <= extents->top)
+            return;
+
+        for( ; *string && screen_x + FONT_WIDTH <= extents->left; x += 8, screen_x += 8, string++);
+
+        for( ; *string && screen_x <= extents->right; x += 8, screen_x += 8)
+            Context_draw_char_pixel(context, *(string++), x, y, pixel);
+
+        return;
+    }
+
     for( ; *string; x += 8)
-        Context_draw_char(context, *(string++), x, y, color);
-}
\ No newline at end of file
+        Context_draw_char_pixel(context, *(string++), x, y, pixel);
+}
+
+//Note that an area of the screen has been drawn into and will need to be
+//presented. We keep the list short by dropping rects that are already
+//covered, and once it's full we fold the new rect into whichever existing
+//one grows the least by taking it in
+void Context_add_damage(Context* context, Rect* rect) {
+
+    int i, best_index, area, best_area;
+    Rect added_rect, *cur_rect;
+
+    context = Context_for_thread(context);
+
+    //Nothing outside of the framebuffer can be presented anyhow
+    added_rect.top = rect->top < 0 ? 0 : rect->top;
+    added_rect.left = rect->left < 0 ? 0 : rect->left;
+    added_rect.bottom = rect->bottom >= context->height ? context->height - 1 : rect->bottom;
+    added_rect.right = rect->right >= context->width ? context->width - 1 : rect->right;
+
+    if(added_rect.top > added_rect.bottom || added_rect.left > added_rect.right)
+        return;
+
+    for(i = 0; i < context->damage_count; ) {
+
+        cur_rect = &context->damage_rects[i];
+
+        //Already covered, nothing to do
+        if(cur_rect->top <= added_rect.top && cur_rect->left <= added_rect.left &&
+           cur_rect->bottom >= added_rect.bottom && cur_rect->right >= added_rect.right)
+            return;
+
+        //The new rect covers an existing one, so the old one can go
+        if(added_rect.top <= cur_rect->top && added_rect.left <= cur_rect->left &&
+           added_rect.bottom >= cur_rect->bottom && added_rect.right >= cur_rect->right) {
+
+            context->damage_rects[i] = context->damage_rects[--context->damage_count];
+            continue;
+        }
+
+        i++;
+    }
+
+    if(context->damage_count < CONTEXT_MAX_DAMAGE) {
+
+        context->damage_rects[context->damage_count++] = added_rect;
+        return;
+    }
+
+    //Out of room, so find the cheapest rect to merge with
+    best_index = 0;
+    best_area = -1;
+
+    for(i = 0; i < context->damage_count; i++) {
+
+        cur_rect = &context->damage_rects[i];
+        area = ((cur_rect->bottom > added_rect.bottom ? cur_rect->bottom : added_rect.bottom) -
+                (cur_rect->top < added_rect.top ? cur_rect->top : added_rect.top) + 1) *
+               ((cur_rect->right > added_rect.right ? cur_rect->right : added_rect.right) -
+                (cur_rect->left < added_rect.left ? cur_rect->left : added_rect.left) + 1) -
+               ((cur_rect->bottom - cur_rect->top + 1) * (cur_rect->right - cur_rect->left + 1));
+
+        if(best_area < 0 || area < best_area) {
+
+            best_area = area;
+            best_index = i;
+        }
+    }
+
+    cur_rect = &context->damage_rects[best_index];
+    
+    if(added_rect.top < cur_rect->top)
+        cur_rect->top = added_rect.top;
+
+    if(added_rect.left < cur_rect->left)
+        cur_rect->left = added_rect.left;
+
+    if(added_rect.bottom > cur_rect->bottom)
+        cur_rect->bottom = added_rect.bottom;
+
+    if(added_rect.right > cur_rect->right)
+        cur_rect->right = added_rect.right;
+}
+
+//Forget about all damage, usually because it has just been presented
+void Context_clear_damage(Context* context) {
+
+    context = Context_for_thread(context);
+
+    context->damage_count = 0;
+}
+
+//Copy the stale parts of one rect of the screen over from stale_source
+void Context_copy_stale(Context* context, Rect* rect) {
+
+    int y, width;
+    unsigned int offset;
+
+    width = rect->right - rect->left + 1;
+
+    for(y = rect->top; y <= rect->bottom; y++) {
+
+        offset = (y * context->width) + rect->left;
+        memcpy(context->buffer + offset, context->stale_source + offset, sizeof(Pixel) * width);
+    }
+
+    context->caught_up_pixels += width * (rect->bottom - rect->top + 1);
+}
+
+//Bring all of the buffer up to date with the screen
+void Context_catch_up_all(Context* context) {
+
+    int i;
+
+    context = Context_for_thread(context);
+
+    if(!context->stale_region)
+        return;
+
+    for(i = 0; i < context->stale_region->count; i++)
+        Context_copy_stale(context, &context->stale_region->rects[i]);
+
+    Region_clear(context->stale_region);
+}
+
+//Bring one rect (in screen coordinates) of the buffer up to date with the
+//screen, before something reads its pixels or only draws over some of them
+void Context_catch_up(Context* context, Rect* rect) {
+
+    int i;
+    Rect stale_rect;
+
+    context = Context_for_thread(context);
+
+    if(!context->stale_region || !Region_intersects_rect(context->stale_region, rect))
+        return;
+
+    for(i = 0; i < context->stale_region->count; i++) {
+
+        stale_rect = context->stale_region->rects[i];
+
+        if(stale_rect.top < rect->top)
+            stale_rect.top = rect->top;
+
+        if(stale_rect.left < rect->left)
+            stale_rect.left = rect->left;
+
+        if(stale_rect.bottom > rect->bottom)
+            stale_rect.bottom = rect->bottom;
+
+        if(stale_rect.right > rect->right)
+            stale_rect.right = rect->right;
+
+        if(stale_rect.top <= stale_rect.bottom && stale_rect.left <= stale_rect.right)
+            Context_copy_stale(context, &stale_rect);
+    }
+
+    //Copying it again later would do no harm, just waste time
+    if(!Region_subtract_rect(context->stale_region, rect))
+        Context_catch_up_all(context);
+}
+
+//Note that every pixel of region (in screen coordinates) is about to be
+//drawn over, so there's no need to catch it up. This has to come before
+//the drawing: if it can't be noted down, everything gets caught up on the
+//spot instead, which is only safe while there's nothing there to lose
+void Context_mark_current(Context* context, Region* region) {
+
+    context = Context_for_thread(context);
+
+    if(!context->stale_region || !context->stale_region->count)
+        return;
+
+    if(!Region_subtract(context->stale_region, context->stale_region, region))
+        Context_catch_up_all(context);
+}
@@ -4,24 +4,91 @@
 #include <inttypes.h>
 #include "list.h"
 #include "rect.h"
+#include "region.h"
+#include "arena.h"
+#include "pixel.h"
 
 //================| Context Class Declaration |================//
 
+//How many separate damage rects we track before we start merging them
+#define CONTEXT_MAX_DAMAGE 16
+
+//Starting size of the scratch memory for a single event's worth of painting
+#define CONTEXT_FRAME_ARENA_SIZE (64 * 1024)
+
+//How many fills can be batched up before the batch has to be drawn
+#define CONTEXT_MAX_BATCH 64
+
+//Fills only get batched when the clip region is cut into more rects than
+//this. With fewer, walking the region once per fill costs next to nothing
+//and batching is just overhead (see bench_batch)
+#define CONTEXT_BATCH_THRESHOLD 128
+
+//Clip regions cut into more rects than this get drawn through a clip mask
+//instead of one rect at a time, see Context_build_clip_mask. Clipping to
+//rects is quicker until there are a few hundred of them (see bench_clip)
+#define CONTEXT_MASK_THRESHOLD 512
+
+struct Compositor_struct;
+struct DisplayList_struct;
+
+//Running totals of the drawing work done through a context, for telling
+//what a slow operation is spending its time on. They keep adding up until
+//Context_reset_stats is called, usually once per frame
+typedef struct ContextStats_struct {
+    unsigned long pixels_written; //Pixels filled in by rects and glyphs
+    unsigned long overdraw; //Pixels written that already had been since the last reset
+    unsigned long clip_rects_processed; //One per clip rect a primitive was drawn through
+    unsigned long clip_rects_split; //Clip rects cut into by subtracting a rect
+    unsigned long clip_rects_created; //The pieces those were cut into
+    unsigned long paint_calls; //Window paint handlers called
+    unsigned long windows_painted; //Windows drawn, whether by handler or by display list
+} ContextStats;
+
 //A structure for holding information about a framebuffer
 typedef struct Context_struct {  
-    uint32_t* buffer; //A pointer to our framebuffer
+    Pixel* buffer; //A pointer to our framebuffer
     uint16_t width; //The dimensions of the framebuffer
     uint16_t height; 
     int translate_x; //Our new translation values
     int translate_y;
-    List* clip_rects;
+    Region* clip_region;
     uint8_t clipping_on;
+    Rect damage_rects[CONTEXT_MAX_DAMAGE]; //Screen areas drawn into since the last present
+    int damage_count;
+    Arena* frame_arena; //Scratch memory for the event being handled, see arena.h (none for compositor workers)
+    struct Compositor_struct* compositor; //Paints big areas on several threads, if set
+    struct DisplayList_struct* recording; //If set, drawing calls get recorded here instead
+    ContextStats stats;
+    uint8_t* write_counts; //Times each pixel was written since the last reset, if tracking overdraw
+    Region* paint_log; //If set, every screen area Window_paint is asked to paint gets added to it
+    uint8_t offscreen; //Set if we own our buffer and borrow another context's frame arena
+    int batch_depth; //Nonzero while fills are being batched, see Context_begin_batch
+    int batch_count;
+    Rect batch_rects[CONTEXT_MAX_BATCH]; //The batched fills, in screen coordinates
+    Pixel batch_colors[CONTEXT_MAX_BATCH]; //Already turned into pixels
+    int mask_threshold; //Starts out as CONTEXT_MASK_THRESHOLD
+    int batch_threshold; //Starts out as CONTEXT_BATCH_THRESHOLD
+    uint8_t* clip_mask; //One bit per pixel of clip_mask_bounds, set if it's in the clip region
+    unsigned int clip_mask_size; //Bytes allocated for clip_mask
+    unsigned int clip_mask_stride; //Bytes from one row of clip_mask to the next
+    Rect clip_mask_bounds; //The part of the screen clip_mask covers
+    uint8_t clip_mask_valid; //Zero when clip_mask needs to be rebuilt from clip_region
+    Region* stale_region; //With a swap chain, the parts of buffer still behind the screen, see swapchain.h
+    Pixel* stale_source; //The buffer on screen, to catch those up from
+    unsigned long caught_up_pixels; //Running total copied over from stale_source
 } Context;
 
 //Methods
-Context* Context_new(uint16_t width, uint16_t height, uint32_t* buffer);
+Context* Context_new(uint16_t width, uint16_t height, Pixel* buffer);
+Context* Context_new_offscreen(Context* screen, uint16_t width, uint16_t height);
+Context* Context_new_worker(Context* screen);
+void Context_delete(Context* context);
 void Context_fill_rect(Context* context, int x, int y,  
                        unsigned int width, unsigned int height, uint32_t color);
+void Context_fill_rects(Context* context, Rect* rects, uint32_t* colors, int count);
+void Context_begin_batch(Context* context);
+void Context_end_batch(Context* context);
 void Context_horizontal_line(Context* context, int x, int y,
                              unsigned int length, uint32_t color);
 void Context_vertical_line(Context* context, int x, int y,
@@ -30,8 +97,25 @@ void Context_draw_rect(Context* context, int x, int y,
                        unsigned int width, unsigned int height, uint32_t color);
 void Context_intersect_clip_rect(Context* context, Rect* rect);                       
 void Context_subtract_clip_rect(Context* context, Rect* subtracted_rect);                       
+int Context_subtract_region_rect(Context* context, Region* region, Rect* rect);
 void Context_add_clip_rect(Context* context, Rect* rect);
+void Context_add_clip_region(Context* context, Region* region);
+void Context_set_clip_region(Context* context, Region* region, Region* limit_region);
 void Context_clear_clip_rects(Context* context);
 void Context_draw_text(Context* context, char* string, int x, int y, uint32_t color);
+void Context_copy_rect(Context* context, int source_x, int source_y, unsigned int width,
+                       unsigned int height, int dest_x, int dest_y);
+void Context_copy_region(Context* context, Region* region, int x, int y);
+void Context_blit(Context* context, Context* source, int x, int y);
+void Context_add_damage(Context* context, Rect* rect);
+void Context_clear_damage(Context* context);
+void Context_catch_up(Context* context, Rect* rect);
+void Context_catch_up_all(Context* context);
+void Context_mark_current(Context* context, Region* region);
+void Context_set_thread_target(Context* screen, Context* target);
+Context* Context_for_thread(Context* context);
+int Context_track_overdraw(Context* context, int enable);
+void Context_reset_stats(Context* context);
+void Context_merge_stats(Context* context, Context* other);
 
 #endif //CONTEXT_H
@@ -56,6 +56,11 @@ Desktop* Desktop_new(Context* context) {
     desktop->mouse_x = desktop->window.context->width / 2;
     desktop->mouse_y = desktop->window.context->height / 2;
 
+    //The cursor doesn't go up until the first mouse event
+    desktop->cursor_visible = 0;
+    desktop->cursor_x = desktop->mouse_x;
+    desktop->cursor_y = desktop->mouse_y;
+
     return desktop;
 }
 
@@ -71,68 +76,106 @@ void Desktop_paint_handler(Window* desktop_window) {
                       0, desktop_window->height - 12, 0xFFFFFFFF);
 }
 
-//Our overload of the Window_process_mouse function used to capture the screen mouse position 
-void Desktop_process_mouse(Desktop* desktop, uint16_t mouse_x,
-                           uint16_t mouse_y, uint8_t mouse_buttons) {
+//Take the cursor off of the screen by putting back the pixels it was drawn
+//over. Anything that paints into the framebuffer has to do this first, or
+//the saved pixels would go stale and the cursor would leave a trail
+void Desktop_hide_cursor(Desktop* desktop) {
 
-    int i, x, y;
-    Window* child;
-    List* dirty_list;
-    Rect* mouse_rect;
+    int x, y;
+    Rect cursor_rect;
+    Context* context = desktop->window.context;
 
-    //Do the old generic mouse handling
-    Window_process_mouse((Window*)desktop, mouse_x, mouse_y, mouse_buttons);
+    if(!desktop->cursor_visible)
+        return;
 
-    //Window painting now happens inside of the window raise and move operations
+    cursor_rect.top = desktop->cursor_y;
+    cursor_rect.left = desktop->cursor_x;
+    cursor_rect.bottom = desktop->cursor_y + MOUSE_HEIGHT - 1;
+    cursor_rect.right = desktop->cursor_x + MOUSE_WIDTH - 1;
+    Context_catch_up(context, &cursor_rect);
 
-    //Build a dirty rect list for the mouse area
-    if(!(dirty_list = List_new()))
-        return;
+    //Copy back only as much as fit on the screen when it was saved
+    for(y = 0; y < MOUSE_HEIGHT && (y + desktop->cursor_y) < context->height; y++)
+        for(x = 0; x < MOUSE_WIDTH && (x + desktop->cursor_x) < context->width; x++)
+            context->buffer[(y + desktop->cursor_y) * context->width + (x + desktop->cursor_x)] =
+                desktop->cursor_save[y * MOUSE_WIDTH + x];
 
-    if(!(mouse_rect = Rect_new(desktop->mouse_y, desktop->mouse_x, 
-                               desktop->mouse_y + MOUSE_HEIGHT - 1,
-                               desktop->mouse_x + MOUSE_WIDTH - 1))) {
+    Context_add_damage(context, &cursor_rect);
 
-        free(dirty_list);
-        return;
-    }
+    desktop->cursor_visible = 0;
+}
 
-    List_add(dirty_list, mouse_rect);
+//Save what's under the current mouse position and draw the cursor over it
+void Desktop_show_cursor(Desktop* desktop) {
 
-    //Do a dirty update for the desktop, which will, in turn, do a 
-    //dirty update for all affected child windows
-    Window_paint((Window*)desktop, dirty_list, 1); 
+    int x, y;
+    Pixel* pixel;
+    Rect cursor_rect;
+    Context* context = desktop->window.context;
 
-    //Clean up mouse dirty list
-    List_remove_at(dirty_list, 0);
-    free(dirty_list);
-    free(mouse_rect);
+    if(desktop->cursor_visible)
+        return;
 
-    //Update mouse position
-    desktop->mouse_x = mouse_x;
-    desktop->mouse_y = mouse_y;
+    desktop->cursor_x = desktop->mouse_x;
+    desktop->cursor_y = desktop->mouse_y;
+
+    cursor_rect.top = desktop->cursor_y;
+    cursor_rect.left = desktop->cursor_x;
+    cursor_rect.bottom = desktop->cursor_y + MOUSE_HEIGHT - 1;
+    cursor_rect.right = desktop->cursor_x + MOUSE_WIDTH - 1;
+    Context_catch_up(context, &cursor_rect);
 
-    //No more hacky mouse, instead we're going to rather inefficiently 
-    //copy the pixels from our mouse image into the framebuffer
     for(y = 0; y < MOUSE_HEIGHT; y++) {
 
         //Make sure we don't draw off the bottom of the screen
-        if((y + mouse_y) >= desktop->window.context->height)
+        if((y + desktop->cursor_y) >= context->height)
             break;
 
         for(x = 0; x < MOUSE_WIDTH; x++) {
 
             //Make sure we don't draw off the right side of the screen
-            if((x + mouse_x) >= desktop->window.context->width)
+            if((x + desktop->cursor_x) >= context->width)
                 break;
- 
-            //Don't place a pixel if it's transparent (still going off of ABGR here,
-            //change to suit your palette)
+
+            pixel = &context->buffer[(y + desktop->cursor_y) * context->width + (x + desktop->cursor_x)];
+            desktop->cursor_save[y * MOUSE_WIDTH + x] = *pixel;
+
+            //Don't place a pixel if it's transparent (the image is ABGR no
+            //matter what the screen is, so the alpha byte is always there)
             if(mouse_img[y * MOUSE_WIDTH + x] & 0xFF000000)
-                desktop->window.context->buffer[(y + mouse_y)
-                                                * desktop->window.context->width 
-                                                + (x + mouse_x)
-                                               ] = mouse_img[y * MOUSE_WIDTH + x];
+                *pixel = Pixel_from_color(mouse_img[y * MOUSE_WIDTH + x]);
         }
     }
+
+    Context_add_damage(context, &cursor_rect);
+
+    desktop->cursor_visible = 1;
+}
+
+//Our overload of the Window_process_mouse function used to capture the screen mouse position 
+void Desktop_process_mouse(Desktop* desktop, uint16_t mouse_x,
+                           uint16_t mouse_y, uint8_t mouse_buttons) {
+
+    //Nothing needs to repaint the scene just to get rid of the cursor
+    //anymore: we lift it off of the screen before handling the event, so
+    //any painting the event causes happens on a clean framebuffer, and
+    //then put it back down wherever the mouse ended up
+    Desktop_hide_cursor(desktop);
+
+    //Do the old generic mouse handling
+    Window_process_mouse((Window*)desktop, mouse_x, mouse_y, mouse_buttons);
+
+    //Window painting now happens inside of the window raise and move operations,
+    //except that anything drawn into a window's backing store still needs
+    //to be copied out onto the screen
+    Window_composite_damage((Window*)desktop);
+
+    //Update mouse position
+    desktop->mouse_x = mouse_x;
+    desktop->mouse_y = mouse_y;
+
+    Desktop_show_cursor(desktop);
+
+    //Everything we needed scratch memory for is finished now
+    Arena_reset(desktop->window.context->frame_arena);
 }
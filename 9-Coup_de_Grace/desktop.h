@@ -17,6 +17,10 @@ typedef struct Desktop_struct {
     Window window; //Inherits window class
     uint16_t mouse_x;
     uint16_t mouse_y;
+    uint8_t cursor_visible; //Nonzero while the cursor is drawn into the framebuffer
+    uint16_t cursor_x; //Where the cursor currently on screen was drawn
+    uint16_t cursor_y;
+    Pixel cursor_save[MOUSE_BUFSZ]; //The screen pixels under the cursor
 } Desktop;
 
 //Methods
@@ -24,5 +28,7 @@ Desktop* Desktop_new(Context* context);
 void Desktop_paint_handler(Window* desktop_window);
 void Desktop_process_mouse(Desktop* desktop, uint16_t mouse_x,
                            uint16_t mouse_y, uint8_t mouse_buttons);
+void Desktop_hide_cursor(Desktop* desktop);
+void Desktop_show_cursor(Desktop* desktop);
 
 #endif //DESKTOP_H
@@ -0,0 +1,196 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "displaylist.h"
+#include "region.h"
+
+//================| DisplayList Class Implementation |================//
+
+//Starting sizes for the command array and the text pool
+#define DISPLAYLIST_MIN_COMMANDS 8
+#define DISPLAYLIST_MIN_TEXT 64
+
+//Font cell size, for working out how much room a string takes up
+#define DISPLAYLIST_CHAR_WIDTH 8
+#define DISPLAYLIST_CHAR_HEIGHT 12
+
+//Biggest command dimensions we'll trust for culling. Handlers sometimes
+//pass sizes that underflowed, and those get drawn exactly as they would
+//have been without a recording
+#define DISPLAYLIST_MAX_SIZE 0xFFFF
+
+//Constructor for an empty display list
+DisplayList* DisplayList_new() {
+
+    DisplayList* list;
+    if(!(list = (DisplayList*)malloc(sizeof(DisplayList))))
+        return list;
+
+    list->commands = (DisplayCommand*)0;
+    list->count = 0;
+    list->capacity = 0;
+    list->text = (char*)0;
+    list->text_used = 0;
+    list->text_capacity = 0;
+    list->valid = 0;
+    list->failed = 0;
+
+    return list;
+}
+
+void DisplayList_delete(DisplayList* list) {
+
+    free(list->commands);
+    free(list->text);
+    free(list);
+}
+
+//Throw away the recording, keeping the memory around for the next one
+void DisplayList_clear(DisplayList* list) {
+
+    list->count = 0;
+    list->text_used = 0;
+    list->valid = 0;
+    list->failed = 0;
+}
+
+//Get a new command at the end of the list, or null if we're out of memory
+DisplayCommand* DisplayList_next_command(DisplayList* list) {
+
+    int new_capacity;
+    DisplayCommand* new_commands;
+
+    if(list->count == list->capacity) {
+
+        new_capacity = list->capacity ? list->capacity * 2 : DISPLAYLIST_MIN_COMMANDS;
+
+        if(!(new_commands = (DisplayCommand*)realloc(list->commands,
+                                                     sizeof(DisplayCommand) * new_capacity))) {
+
+            list->failed = 1;
+            return (DisplayCommand*)0;
+        }
+
+        list->commands = new_commands;
+        list->capacity = new_capacity;
+    }
+
+    return &list->commands[list->count++];
+}
+
+//Record a rectangle fill or outline
+int DisplayList_add_rect(DisplayList* list, uint8_t type, int x, int y,
+                         unsigned int width, unsigned int height, uint32_t color) {
+
+    DisplayCommand* command;
+
+    if(!(command = DisplayList_next_command(list)))
+        return 0;
+
+    command->type = type;
+    command->color = color;
+    command->x = x;
+    command->y = y;
+    command->width = width;
+    command->height = height;
+    command->text_offset = 0;
+
+    //An outline less than two pixels tall draws its sides outside of its
+    //own rect, so those don't get culled
+    if(type == DISPLAY_DRAW_RECT)
+        command->cullable = width >= 1 && height >= 2;
+    else
+        command->cullable = width >= 1 && height >= 1;
+
+    command->cullable = command->cullable &&
+                        width <= DISPLAYLIST_MAX_SIZE && height <= DISPLAYLIST_MAX_SIZE;
+
+    return 1;
+}
+
+//Record the first length characters of a string, copying them into the
+//list since the original is likely to change before we replay
+int DisplayList_add_text(DisplayList* list, char* string, int length,
+                         int x, int y, uint32_t color) {
+
+    int i, new_capacity;
+    char* new_text;
+    DisplayCommand* command;
+
+    if(list->text_used + length + 1 > list->text_capacity) {
+
+        new_capacity = list->text_capacity ? list->text_capacity : DISPLAYLIST_MIN_TEXT;
+
+        while(list->text_used + length + 1 > new_capacity)
+            new_capacity *= 2;
+
+        if(!(new_text = (char*)realloc(list->text, new_capacity))) {
+
+            list->failed = 1;
+            return 0;
+        }
+
+        list->text = new_text;
+        list->text_capacity = new_capacity;
+    }
+
+    if(!(command = DisplayList_next_command(list)))
+        return 0;
+
+    command->type = DISPLAY_DRAW_TEXT;
+    command->color = color;
+    command->x = x;
+    command->y = y;
+    command->width = length * DISPLAYLIST_CHAR_WIDTH;
+    command->height = DISPLAYLIST_CHAR_HEIGHT;
+    command->text_offset = list->text_used;
+    command->cullable = length > 0;
+
+    for(i = 0; i < length; i++)
+        list->text[list->text_used++] = string[i];
+
+    list->text[list->text_used++] = 0;
+
+    return 1;
+}
+
+//Draw everything in the list into the context using its current clipping
+//and translation, skipping commands that fall entirely outside of the clip
+void DisplayList_replay(DisplayList* list, Context* context) {
+
+    int i;
+    Rect bounds;
+    DisplayCommand* command;
+    Context* target = Context_for_thread(context);
+
+    //The fills between each bit of text get clipped together in batches
+    Context_begin_batch(context);
+
+    for(i = 0; i < list->count; i++) {
+
+        command = &list->commands[i];
+
+        //With clipping on, nothing gets drawn outside of the clip region
+        if(target->clipping_on && command->cullable) {
+
+            bounds.top = command->y + target->translate_y;
+            bounds.left = command->x + target->translate_x;
+            bounds.bottom = bounds.top + (int)command->height - 1;
+            bounds.right = bounds.left + (int)command->width - 1;
+
+            if(!Region_intersects_rect(target->clip_region, &bounds))
+                continue;
+        }
+
+        if(command->type == DISPLAY_FILL_RECT)
+            Context_fill_rect(context, command->x, command->y,
+                              command->width, command->height, command->color);
+        else if(command->type == DISPLAY_DRAW_RECT)
+            Context_draw_rect(context, command->x, command->y,
+                              command->width, command->height, command->color);
+        else
+            Context_draw_text(context, list->text + command->text_offset,
+                              command->x, command->y, command->color);
+    }
+
+    Context_end_batch(context);
+}
@@ -0,0 +1,57 @@
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include <inttypes.h>
+#include "context.h"
+
+//================| DisplayList Class Declaration |================//
+
+//A recording of the drawing calls a window's paint handler made. While a
+//context has a display list to record into, its fill_rect, draw_rect, line
+//and text calls get appended to the list instead of drawn. Coordinates are
+//stored exactly as the handler passed them, relative to the window, so the
+//recording stays good wherever the window moves to.
+//
+//Replaying the list draws the same thing through the context's current
+//clipping and translation. Before any pixel work, each command's bounds
+//get checked against the clipping region and commands that can't touch it
+//are skipped whole
+
+//Kinds of command
+#define DISPLAY_FILL_RECT 1
+#define DISPLAY_DRAW_RECT 2
+#define DISPLAY_DRAW_TEXT 3
+
+typedef struct DisplayCommand_struct {
+    uint8_t type;
+    uint8_t cullable; //Zero if the bounds below can't be trusted for culling
+    uint32_t color;
+    int x;
+    int y;
+    unsigned int width; //For text, the width and height of the whole string
+    unsigned int height;
+    int text_offset; //Where a text command's string starts in the text pool
+} DisplayCommand;
+
+typedef struct DisplayList_struct {
+    DisplayCommand* commands;
+    int count;
+    int capacity;
+    char* text; //Every recorded string, back to back with their terminators
+    int text_used;
+    int text_capacity;
+    uint8_t valid; //Set once a complete recording has been made
+    uint8_t failed; //Set if we ran out of memory while recording
+} DisplayList;
+
+//Methods
+DisplayList* DisplayList_new();
+void DisplayList_delete(DisplayList* list);
+void DisplayList_clear(DisplayList* list);
+int DisplayList_add_rect(DisplayList* list, uint8_t type, int x, int y,
+                         unsigned int width, unsigned int height, uint32_t color);
+int DisplayList_add_text(DisplayList* list, char* string, int length,
+                         int x, int y, uint32_t color);
+void DisplayList_replay(DisplayList* list, Context* context);
+
+#endif //DISPLAYLIST_H
@@ -1,6 +1,12 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include "context.h"
 #include "desktop.h"
 #include "calculator.h"
+#include "compositor.h"
+#include "statshud.h"
+#include "heatmap.h"
+#include "swapchain.h"
 #include "../fake_lib/fake_os.h"
 
 //================| Entry Point |================//
@@ -9,10 +15,76 @@
 //as well as our mouse event callback
 Desktop* desktop;
 
-//The callback that our mouse device will trigger on mouse updates
-void main_mouse_callback(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+//Debug views of how much drawing each frame took, if turned on
+StatsHud* stats_hud = (StatsHud*)0;
+Heatmap* heatmap = (Heatmap*)0;
 
-    Desktop_process_mouse(desktop, mouse_x, mouse_y, buttons);
+//Set if frames are being flipped through several buffers
+SwapChain* swap_chain = (SwapChain*)0;
+
+//Hand the areas of the screen that were drawn into since the last call over
+//to the OS to be shown
+void present_damage(Context* context) {
+
+    int i;
+    fo_rect present_rects[CONTEXT_MAX_DAMAGE];
+
+    if(swap_chain) {
+
+        SwapChain_present(swap_chain);
+        return;
+    }
+
+    for(i = 0; i < context->damage_count; i++) {
+
+        present_rects[i].x = context->damage_rects[i].left;
+        present_rects[i].y = context->damage_rects[i].top;
+        present_rects[i].width = context->damage_rects[i].right - context->damage_rects[i].left + 1;
+        present_rects[i].height = context->damage_rects[i].bottom - context->damage_rects[i].top + 1;
+    }
+
+    fake_os_present(present_rects, context->damage_count);
+    Context_clear_damage(context);
+}
+
+//Present, with the heatmap drawn over the top if it's on
+void present_frame(Context* context) {
+
+    if(heatmap)
+        Heatmap_show(heatmap);
+
+    present_damage(context);
+
+    if(heatmap)
+        Heatmap_hide(heatmap);
+
+    Context_reset_stats(context);
+}
+
+//Called once per display frame: handle this frame's (already coalesced)
+//mouse events, then show whatever they changed all in one go
+void main_frame_callback(void) {
+
+    uint16_t mouse_x, mouse_y;
+    uint8_t buttons;
+    Context* context = desktop->window.context;
+
+    while(fake_os_pollMouseEvent(&mouse_x, &mouse_y, &buttons))
+        Desktop_process_mouse(desktop, mouse_x, mouse_y, buttons);
+
+    //Put up what handling those events took, unless they didn't draw
+    //anything (which would just hide the last interesting numbers). The
+    //HUD's own painting gets thrown out with the rest of the frame's counts
+    if(stats_hud && context->stats.pixels_written) {
+
+        Desktop_hide_cursor(desktop);
+        StatsHud_update(stats_hud, &context->stats);
+        Window_composite_damage((Window*)desktop);
+        Desktop_show_cursor(desktop);
+        Arena_reset(context->frame_arena);
+    }
+
+    present_frame(context);
 }
 
 //Button handler for creating a new calculator
@@ -24,34 +96,118 @@ void spawn_calculator(Button* button, int x, int y) {
     Window_move((Window*)temp_calc, 0, 0);
 }
 
+//Clicking on the stats HUD flips the heatmap on and off
+void toggle_heatmap(Window* hud_window, int x, int y) {
+
+    Heatmap_set_enabled(heatmap, !heatmap->enabled);
+}
+
 //Create and draw a few rectangles and exit
 int main(int argc, char* argv[]) {
 
+    int exit_code;
+    char* thread_count;
+    char* buffer_count;
+
     //Fill this in with the info particular to your project
     Context* context = Context_new(0, 0, 0);
-    context->buffer = fake_os_getActiveVesaBuffer(&context->width, &context->height);
+
+    //Flipping between two or three buffers is opt-in, since catching each
+    //back buffer up costs a copy of what the last frames changed. If the
+    //swap chain can't be set up we draw straight into the one framebuffer
+    if(!(buffer_count = getenv("WSBE_BUFFERS")) ||
+       !(swap_chain = SwapChain_new(context, atoi(buffer_count))))
+        context->buffer = fake_os_getActiveVesaBuffer(&context->width, &context->height);
+
+    //Painting on several threads is opt-in, since it only pays off for big
+    //repaints on machines with cores to spare. If the threads can't be
+    //started we just paint on this one like always
+    if((thread_count = getenv("WSBE_THREADS")))
+        context->compositor = Compositor_new(context, atoi(thread_count));
 
     //Create the desktop 
     desktop = Desktop_new(context);
 
+    //Drawing each window into a backing store of its own costs a copy of
+    //its pixels, but means uncovering or dragging it is just a copy back
+    //out instead of a repaint, so that's opt-in too
+    if(getenv("WSBE_RETAINED"))
+        desktop->window.retain_children = 1;
+
     //Create a simple launcher window 
     Button* launch_button = Button_new(10, 10, 150, 30);
     Window_set_title((Window*)launch_button, "New Calculator");
     launch_button->onmousedown = spawn_calculator;
     Window_insert_child((Window*)desktop, (Window*)launch_button);
 
+    //The debug views both need to know how many times every pixel gets
+    //written, which costs, so we only keep track when one of them is asked for
+    if(getenv("WSBE_HUD") || getenv("WSBE_HEATMAP")) {
+
+        Context_track_overdraw(context, 1);
+        heatmap = Heatmap_new(context);
+    }
+
+    if(heatmap && getenv("WSBE_HEATMAP"))
+        Heatmap_set_enabled(heatmap, 1);
+
+    //The stats HUD goes in the bottom right corner
+    if(getenv("WSBE_HUD") &&
+       (stats_hud = StatsHud_new(context->width - STATSHUD_WIDTH - 10,
+                                 context->height - STATSHUD_HEIGHT - 10))) {
+
+        if(heatmap)
+            stats_hud->window.mousedown_function = toggle_heatmap;
+
+        Window_insert_child((Window*)desktop, (Window*)stats_hud);
+    }
+
     //Initial draw
-    Window_paint((Window*)desktop, (List*)0, 1);
+    Window_paint((Window*)desktop, (Region*)0, 1);
+    Arena_reset(context->frame_arena);
+    present_frame(context);
+
+    //Rather than handling every mouse event the moment it arrives, we poll
+    //for them once per frame so we never composite more often than the
+    //display can actually show
+    fake_os_setInputMode(FO_INPUT_FRAME_PACED);
+    fake_os_installFrameCallback(main_frame_callback);
+
+    //Let the OS deliver events until it's done with us
+    //(in the browser this returns immediately and the page keeps us alive)
+    exit_code = fake_os_runMainLoop();
+
+    //Reporting and cleaning up are only for once the events have really run
+    //out. In the browser the page goes on calling us after main returns, so
+    //nothing has been used yet and everything has to be left as it is
+    if(exit_code != FO_LOOP_RUNNING) {
+
+        //Report how much scratch memory painting needed so that
+        //CONTEXT_FRAME_ARENA_SIZE can be tuned
+        printf("frame arena: %u byte high-water mark of %u, %u passes overflowed\n",
+               context->frame_arena->high_water, context->frame_arena->size,
+               context->frame_arena->overflow_resets);
+
+        if(swap_chain) {
+
+            printf("swap chain: %lu pixels copied to catch back buffers up\n",
+                   context->caught_up_pixels);
+            SwapChain_delete(swap_chain);
+            swap_chain = (SwapChain*)0;
+        }
+
+        if(context->compositor) {
+
+            Compositor_delete(context->compositor);
+            context->compositor = (Compositor*)0;
+        }
 
-    //Install our handler of mouse events
-    fake_os_installMouseCallback(main_mouse_callback);
+        if(heatmap) {
 
-    //Polling alternative:
-    //    while(1) {
-    //
-    //        fake_os_waitForMouseUpdate(&mouse_x, &mouse_y, &buttons);
-    //        Desktop_process_mouse(desktop, mouse_x, mouse_y, buttons);
-    //    }
+            Heatmap_delete(heatmap);
+            heatmap = (Heatmap*)0;
+        }
+    }
 
-    return 0; 
+    return exit_code == FO_LOOP_RUNNING ? 0 : exit_code;
 }
@@ -0,0 +1,200 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "heatmap.h"
+
+//================| Heatmap Class Implementation |================//
+
+//Tints for pixels written once, twice, three times and four or more
+uint32_t heatmap_colors[4] = { 0xFF00FF00, 0xFF00FFFF, 0xFF0080FF, 0xFF0000FF };
+
+#define HEATMAP_FLASHCOLOR 0xFFFF00FF
+
+Heatmap* Heatmap_new(Context* context) {
+
+    Heatmap* heatmap;
+    if(!(heatmap = (Heatmap*)malloc(sizeof(Heatmap))))
+        return heatmap;
+
+    if(!(heatmap->paint_log = Region_new())) {
+
+        free(heatmap);
+        return (Heatmap*)0;
+    }
+
+    if(!(heatmap->saved_pixels = (Pixel*)malloc(sizeof(Pixel) *
+                                                context->width * context->height))) {
+
+        Region_delete(heatmap->paint_log);
+        free(heatmap);
+        return (Heatmap*)0;
+    }
+
+    heatmap->context = context;
+    heatmap->saved_count = 0;
+    heatmap->enabled = 0;
+
+    return heatmap;
+}
+
+void Heatmap_delete(Heatmap* heatmap) {
+
+    if(heatmap->context->paint_log == heatmap->paint_log)
+        heatmap->context->paint_log = (Region*)0;
+
+    Region_delete(heatmap->paint_log);
+    free(heatmap->saved_pixels);
+    free(heatmap);
+}
+
+//Turn the overlay on or off. Window_paint only logs what it paints while
+//we're on, so it costs nothing otherwise
+void Heatmap_set_enabled(Heatmap* heatmap, uint8_t enabled) {
+
+    heatmap->enabled = enabled;
+    heatmap->context->paint_log = enabled ? heatmap->paint_log : (Region*)0;
+    Region_clear(heatmap->paint_log);
+}
+
+//Blend a pixel halfway towards a tint color
+uint32_t Heatmap_tint(uint32_t pixel, uint32_t color) {
+
+    return (((pixel >> 1) & 0x7F7F7F7F) + ((color >> 1) & 0x7F7F7F7F)) | 0xFF000000;
+}
+
+//Flash one pixel of an outline, as long as it's somewhere we saved and so
+//can put back afterwards
+void Heatmap_flash_pixel(Heatmap* heatmap, int x, int y) {
+
+    int i;
+    Rect* rect;
+
+    for(i = 0; i < heatmap->saved_count; i++) {
+
+        rect = &heatmap->saved_rects[i];
+
+        if(x >= rect->left && x <= rect->right && y >= rect->top && y <= rect->bottom) {
+
+            heatmap->context->buffer[(y * heatmap->context->width) + x] = Pixel_from_color(HEATMAP_FLASHCOLOR);
+            heatmap->saved_changed[i] = 1;
+            return;
+        }
+    }
+}
+
+void Heatmap_flash_rect(Heatmap* heatmap, Rect* rect) {
+
+    int x, y;
+
+    for(x = rect->left; x <= rect->right; x++) {
+
+        Heatmap_flash_pixel(heatmap, x, rect->top);
+        Heatmap_flash_pixel(heatmap, x, rect->bottom);
+    }
+
+    for(y = rect->top + 1; y < rect->bottom; y++) {
+
+        Heatmap_flash_pixel(heatmap, rect->left, y);
+        Heatmap_flash_pixel(heatmap, rect->right, y);
+    }
+}
+
+//Damage rects can overlap, so this tells whether a pixel of the ith one
+//has already been taken care of as part of an earlier one
+int Heatmap_in_earlier_rect(Heatmap* heatmap, int i, int x, int y) {
+
+    Rect* rect;
+
+    while(i--) {
+
+        rect = &heatmap->saved_rects[i];
+
+        if(x >= rect->left && x <= rect->right && y >= rect->top && y <= rect->bottom)
+            return 1;
+    }
+
+    return 0;
+}
+
+//Draw the overlay over everything that's about to be presented, saving
+//what was there first
+void Heatmap_show(Heatmap* heatmap) {
+
+    int i, x, y, offset;
+    uint8_t count;
+    Rect* rect;
+    Context* context = heatmap->context;
+
+    heatmap->saved_count = 0;
+
+    if(!heatmap->enabled || !context->write_counts)
+        return;
+
+    for(i = 0; i < context->damage_count; i++) {
+
+        rect = &context->damage_rects[i];
+        Context_catch_up(context, rect);
+        heatmap->saved_rects[heatmap->saved_count] = *rect;
+        heatmap->saved_changed[heatmap->saved_count++] = 0;
+
+        for(y = rect->top; y <= rect->bottom; y++) {
+
+            for(x = rect->left; x <= rect->right; x++) {
+
+                if(i && Heatmap_in_earlier_rect(heatmap, i, x, y))
+                    continue;
+
+                offset = (y * context->width) + x;
+                heatmap->saved_pixels[offset] = context->buffer[offset];
+
+                if(!(count = context->write_counts[offset]))
+                    continue;
+
+                //Tinting works on colors, so this is one place that has to
+                //go back and forth for every pixel
+                context->buffer[offset] =
+                    Pixel_from_color(Heatmap_tint(Pixel_to_color(context->buffer[offset]),
+                                                  heatmap_colors[count > 4 ? 3 : count - 1]));
+                heatmap->saved_changed[i] = 1;
+            }
+        }
+    }
+
+    for(i = 0; i < heatmap->paint_log->count; i++)
+        Heatmap_flash_rect(heatmap, &heatmap->paint_log->rects[i]);
+
+    Region_clear(heatmap->paint_log);
+}
+
+//Put back the pixels the overlay covered, and damage the ones we drew over
+//so that the next frame shows the real thing there. (Anything that was
+//only being presented to clean up after the last frame's overlay is left
+//alone, or the overlay would never go away)
+void Heatmap_hide(Heatmap* heatmap) {
+
+    int i, x, y, offset;
+    Rect* rect;
+    Context* context = heatmap->context;
+
+    for(i = 0; i < heatmap->saved_count; i++) {
+
+        rect = &heatmap->saved_rects[i];
+
+        //With a swap chain this is the next back buffer, and the screen
+        //it would otherwise catch the rect up from has the overlay in it
+        Context_catch_up(context, rect);
+
+        for(y = rect->top; y <= rect->bottom; y++) {
+
+            for(x = rect->left; x <= rect->right; x++) {
+
+                offset = (y * context->width) + x;
+                context->buffer[offset] = heatmap->saved_pixels[offset];
+            }
+        }
+
+        if(heatmap->saved_changed[i])
+            Context_add_damage(context, rect);
+    }
+
+    heatmap->saved_count = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <inttypes.h>
+#include "context.h"
+#include "region.h"
+
+//================| Heatmap Class Declaration |================//
+
+//A debug view of how much work each frame did. Just before a frame is
+//presented, every pixel drawn during it gets tinted by how many times it
+//was written (green once, then yellow, orange and red for four or more)
+//and the outlines of all of the areas passed to Window_paint are flashed
+//in magenta. Straight after presenting, the real pixels are put back and
+//marked as damaged so that the overlay only stays up until the next frame.
+//
+//Needs the context to be tracking overdraw (see Context_track_overdraw)
+
+typedef struct Heatmap_struct {
+    Context* context;
+    Region* paint_log; //The areas passed to Window_paint this frame
+    Pixel* saved_pixels; //What was underneath the overlay, at screen offsets
+    Rect saved_rects[CONTEXT_MAX_DAMAGE]; //Where the overlay is drawn
+    uint8_t saved_changed[CONTEXT_MAX_DAMAGE]; //Whether we actually drew anything there
+    int saved_count;
+    uint8_t enabled;
+} Heatmap;
+
+//Methods
+Heatmap* Heatmap_new(Context* context);
+void Heatmap_delete(Heatmap* heatmap);
+void Heatmap_set_enabled(Heatmap* heatmap, uint8_t enabled);
+void Heatmap_show(Heatmap* heatmap);
+void Heatmap_hide(Heatmap* heatmap);
+
+#endif //HEATMAP_H
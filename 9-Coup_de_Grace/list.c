@@ -3,7 +3,10 @@
 #include "list.h"
 
 
-//================| ListNode Class Implementation |================//
+//================| List Class Implementation |================//
+
+//How many payloads a list has room for the first time it grows
+#define LIST_MIN_CAPACITY 8
 
 //Basic list constructor
 List* List_new() {
@@ -16,41 +19,96 @@ List* List_new() {
     //Fill in initial property values
     //(All we know for now is that we start out with no items) 
     list->count = 0;
-    list->root_node = (ListNode*)0;
+    list->capacity = 0;
+    list->first = 0;
+    list->items = (void**)0;
+    list->arena = (Arena*)0;
 
     return list;
 }
 
-//Insert a payload at the end of the list
+//Make a list that lives in the passed arena (items and all) until the
+//arena is reset. Good for throwaway lists built during painting
+List* List_new_in(Arena* arena) {
+
+    List* list;
+    if(!(list = (List*)Arena_alloc(arena, sizeof(List))))
+        return list;
+
+    list->count = 0;
+    list->capacity = 0;
+    list->first = 0;
+    list->items = (void**)0;
+    list->arena = arena;
+
+    return list;
+}
+
+//Free a list (but not its payloads)
+void List_delete(List* list) {
+
+    //Arena lists get cleaned up by the arena
+    if(list->arena)
+        return;
+
+    free(list->items);
+    free(list);
+}
+
+//Make room for one more item at the end of the array, either by sliding
+//the list back to the start of the array or by doubling its size
 //Zero is fail, one is success
-int List_add(List* list, void* payload) {
+int List_grow(List* list) {
 
-    //Try to make a new node, exit early on fail 
-    ListNode* new_node;
-    if(!(new_node = ListNode_new(payload))) 
-        return 0;
+    unsigned int i, new_capacity;
+    void** new_items;
 
-    //If there aren't any items in the list yet, assign the
-    //new item to the root node
-    if(!list->root_node) {
- 
-        list->root_node = new_node;        
-    } else {
+    //If at least half of the array is free space in front of the list,
+    //moving the list down is enough
+    if(list->first && list->first >= list->count) {
+
+        for(i = 0; i < list->count; i++)
+            list->items[i] = list->items[list->first + i];
 
-        //Otherwise, we'll find the last node and add our new node after it
-        ListNode* current_node = list->root_node;
+        list->first = 0;
 
-        //Fast forward to the end of the list 
-        while(current_node->next)
-            current_node = current_node->next;
+        return 1;
+    }
+
+    new_capacity = list->capacity ? list->capacity * 2 : LIST_MIN_CAPACITY;
+
+    if(list->arena) {
+
+        //There's no realloc in an arena, so move the contents over by hand
+        //(the old array gets thrown away along with everything else on reset)
+        if(!(new_items = (void**)Arena_alloc(list->arena, sizeof(void*) * new_capacity)))
+            return 0;
+
+        for(i = 0; i < list->count; i++)
+            new_items[i] = list->items[list->first + i];
+
+        list->first = 0;
+    } else {
 
-        //Make the last node and first node point to each other
-        current_node->next = new_node;
-        new_node->prev = current_node; 
+        if(!(new_items = (void**)realloc(list->items, sizeof(void*) * new_capacity)))
+            return 0;
     }
 
-    //Update the number of items in the list and return success
-    list->count++;
+    list->items = new_items;
+    list->capacity = new_capacity;
+
+    return 1;
+}
+
+//Insert a payload at the end of the list
+//Zero is fail, one is success
+int List_add(List* list, void* payload) {
+
+    //Make room if we're full, exit early on fail
+    if(list->first + list->count == list->capacity && !List_grow(list))
+        return 0;
+
+    list->items[list->first + list->count++] = payload;
 
     return 1;
 }
@@ -59,20 +117,11 @@ int List_add(List* list, void* payload) {
 //Indices are zero-based
 void* List_get_at(List* list, unsigned int index) {
 
-    //If there's nothing in the list or we're requesting beyond the end of
-    //the list, return nothing
-    if(list->count == 0 || index >= list->count) 
+    //If we're requesting beyond the end of the list, return nothing
+    if(index >= list->count) 
         return (void*)0;
 
-    //Iterate through the items in the list until we hit our index
-    ListNode* current_node = list->root_node;
-
-    //Iteration, making sure we don't hang on malformed lists
-    for(unsigned int current_index = 0; (current_index < index) && current_node; current_index++)
-        current_node = current_node->next;
-
-    //Return the payload, guarding against malformed lists
-    return current_node ? current_node->payload : (void*)0;
+    return list->items[list->first + index];
 }
 
 //Remove the item at the specified index from the list and return the item that
@@ -80,49 +129,46 @@ void* List_get_at(List* list, unsigned int index) {
 //Indices are zero-based
 void* List_remove_at(List* list, unsigned int index) {
 
-    //This operates very similarly to List_get_at
-
+    unsigned int i;
     void* payload; 
 
     //Bounds check
-    if(list->count == 0 || index >= list->count) 
+    if(index >= list->count) 
         return (void*)0;
 
-    //Iterate through the items
-    ListNode* current_node = list->root_node;
+    payload = list->items[list->first + index];
+    list->count--; 
 
-    for(unsigned int current_index = 0; (current_index < index) && current_node; current_index++)
-        current_node = current_node->next;
+    //Taking the first item just means starting the list one later
+    if(index == 0) {
 
-    //This is where we differ from List_get_at by stashing the payload,
-    //re-pointing the current node's neighbors to each other and 
-    //freeing the removed node 
+        list->first = list->count ? list->first + 1 : 0;
 
-    //Return early if we got a null node somehow
-    if(!current_node)
-        return (void*)0;
+        return payload;
+    }
 
-    //Stash the payload so we don't lose it when we delete the node     
-    payload =  current_node->payload;
- 
-    //Re-point neighbors to each other 
-    if(current_node->prev)
-        current_node->prev->next = current_node->next;
+    //Otherwise, close the gap by shifting everything after it down by one
+    for(i = list->first + index; i < list->first + list->count; i++)
+        list->items[i] = list->items[i + 1];
 
-    if(current_node->next)
-        current_node->next->prev = current_node->prev;
+    return payload;
+}
 
-    //If the item was the root item, we need to make
-    //the node following it the new root
-    if(index == 0)
-        list->root_node = current_node->next;
+//Point a cursor at the start of a list
+void List_cursor_start(List* list, ListCursor* cursor) {
 
-    //Now that we've clipped the node out of the list, we must free its memory
-    free(current_node); 
+    cursor->list = list;
+    cursor->index = 0;
+}
 
-    //Make sure the count of items is up-to-date
-    list->count--; 
+//Get the payload at the cursor and move it along to the next one
+//Returns zero once the cursor has gone past the end of the list
+int List_cursor_next(ListCursor* cursor, void** payload) {
 
-    //Finally, return the payload
-    return payload;
-}
\ No newline at end of file
+    if(cursor->index >= cursor->list->count)
+        return 0;
+
+    *payload = cursor->list->items[cursor->list->first + cursor->index++];
+
+    return 1;
+}
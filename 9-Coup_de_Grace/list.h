@@ -1,20 +1,38 @@
 #ifndef LIST_H
 #define LIST_H
 
-#include "listnode.h"
+#include "arena.h"
 
 //================| List Class Declaration |================//
 
 //A type to encapsulate a basic dynamic list
+//The payloads are kept in one contiguous array that doubles in size
+//whenever it fills up, so adding to the end is cheap and getting at any
+//index is a single lookup. The list can start partway into the array, so
+//that taking items off of the front (a common way of draining a list) is
+//cheap as well
 typedef struct List_struct {
     unsigned int count; 
-    ListNode* root_node;
+    unsigned int capacity;
+    unsigned int first; //Where in the array the list starts
+    void** items;
+    Arena* arena; //Where our memory comes from, or null for the heap
 } List;
 
+//A position in a list, for walking through it from front to back
+typedef struct ListCursor_struct {
+    List* list;
+    unsigned int index;
+} ListCursor;
+
 //Methods
 List* List_new();
+List* List_new_in(Arena* arena);
+void List_delete(List* list);
 int List_add(List* list, void* payload);
 void* List_get_at(List* list, unsigned int index);
 void* List_remove_at(List* list, unsigned int index);
+void List_cursor_start(List* list, ListCursor* cursor);
+int List_cursor_next(ListCursor* cursor, void** payload);
 
 #endif //LIST_H
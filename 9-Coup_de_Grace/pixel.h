@@ -0,0 +1,26 @@
+#ifndef PIXEL_H
+#define PIXEL_H
+
+#include <inttypes.h>
+#include "../fake_lib/fake_os.h"
+#include "../fake_lib/fake_pixel.h"
+
+//================| Pixel Format |================//
+
+//A pixel is whatever the OS's framebuffer is made of, which gets picked at
+//build time (see FO_PIXEL_FORMAT in fake_os.h). Building for a narrower
+//format means every fill and copy moves a half or a quarter of the bytes.
+//
+//Everything above the drawing routines still deals in 32-bit ABGR colors,
+//so the theme colors and such don't care about the format. Colors get
+//turned into pixels once per drawing call, never per pixel, and the pixel
+//routines in span.c get compiled for the one format we're building for
+
+typedef fo_pixel Pixel;
+
+#define PIXEL_BYTES FO_PIXEL_BYTES
+
+#define Pixel_from_color(color) fake_pixel_from_color(color)
+#define Pixel_to_color(pixel) fake_pixel_to_color(pixel)
+
+#endif //PIXEL_H
@@ -0,0 +1,584 @@
+#include <stdlib.h>
+#include <string.h>
+#include "region.h"
+
+//================| Region Class Implementation |================//
+
+//The boolean operations all run through the same band sweep
+#define REGION_UNION     0
+#define REGION_INTERSECT 1
+#define REGION_SUBTRACT  2
+
+//Smallest allocation we bother making for a rect array
+#define REGION_MIN_CAPACITY 16
+
+//Allocate a new, empty region
+Region* Region_new() {
+
+    //Attempt to allocate the object
+    Region* region;
+    if(!(region = (Region*)malloc(sizeof(Region))))
+        return region;
+
+    //The arrays are only allocated once something gets put in them
+    region->rects = (Rect*)0;
+    region->count = 0;
+    region->capacity = 0;
+    region->spare_rects = (Rect*)0;
+    region->spare_capacity = 0;
+    region->arena = (Arena*)0;
+
+    return region;
+}
+
+//Allocate a new, empty region that lives in the passed arena, along with
+//everything it ever allocates. It goes away when the arena is reset
+Region* Region_new_in(Arena* arena) {
+
+    Region* region;
+    if(!(region = (Region*)Arena_alloc(arena, sizeof(Region))))
+        return region;
+
+    region->rects = (Rect*)0;
+    region->count = 0;
+    region->capacity = 0;
+    region->spare_rects = (Rect*)0;
+    region->spare_capacity = 0;
+    region->arena = arena;
+
+    return region;
+}
+
+void Region_delete(Region* region) {
+
+    //Arena memory gets released all at once by the arena
+    if(region->arena)
+        return;
+
+    free(region->rects);
+    free(region->spare_rects);
+    free(region);
+}
+
+//Empty the region out (keeping its memory around for reuse)
+void Region_clear(Region* region) {
+
+    region->count = 0;
+}
+
+//Make sure the scratch array can hold at least the given number of rects
+int Region_grow_spare(Region* region, int needed) {
+
+    int new_capacity;
+    Rect* new_rects;
+
+    if(needed <= region->spare_capacity)
+        return 1;
+
+    new_capacity = region->spare_capacity ? region->spare_capacity : REGION_MIN_CAPACITY;
+
+    while(new_capacity < needed)
+        new_capacity *= 2;
+
+    //There's no realloc in an arena, so move the contents over by hand
+    //and leave the old array behind for the reset to take care of
+    if(region->arena) {
+
+        if(!(new_rects = (Rect*)Arena_alloc(region->arena, sizeof(Rect) * new_capacity)))
+            return 0;
+
+        if(region->spare_capacity)
+            memcpy(new_rects, region->spare_rects, sizeof(Rect) * region->spare_capacity);
+    } else {
+
+        if(!(new_rects = (Rect*)realloc(region->spare_rects, sizeof(Rect) * new_capacity)))
+            return 0;
+    }
+
+    region->spare_rects = new_rects;
+    region->spare_capacity = new_capacity;
+
+    return 1;
+}
+
+//Make the scratch array (which an operation has just finished building
+//its result in) the region's real rect list, and vice versa
+void Region_swap_spare(Region* region, int count) {
+
+    int i, capacity;
+    Rect* rects;
+
+    rects = region->rects;
+    capacity = region->capacity;
+    region->rects = region->spare_rects;
+    region->capacity = region->spare_capacity;
+    region->spare_rects = rects;
+    region->spare_capacity = capacity;
+    region->count = count;
+
+    if(!count)
+        return;
+
+    //The top and bottom come straight from the first and last bands, but
+    //the sides could come from anywhere
+    region->extents = region->rects[0];
+    region->extents.bottom = region->rects[count - 1].bottom;
+
+    for(i = 1; i < count; i++) {
+
+        if(region->rects[i].left < region->extents.left)
+            region->extents.left = region->rects[i].left;
+
+        if(region->rects[i].right > region->extents.right)
+            region->extents.right = region->rects[i].right;
+    }
+}
+
+//Make the region cover exactly the passed rect
+int Region_set_rect(Region* region, Rect* rect) {
+
+    if(rect->top > rect->bottom || rect->left > rect->right) {
+
+        region->count = 0;
+        return 1;
+    }
+
+    if(!Region_grow_spare(region, 1))
+        return 0;
+
+    region->spare_rects[0] = *rect;
+    Region_swap_spare(region, 1);
+
+    return 1;
+}
+
+//Replace the contents of dest with those of source
+int Region_copy(Region* dest, Region* source) {
+
+    int i;
+
+    if(dest == source)
+        return 1;
+
+    if(!Region_grow_spare(dest, source->count))
+        return 0;
+
+    for(i = 0; i < source->count; i++)
+        dest->spare_rects[i] = source->rects[i];
+
+    Region_swap_spare(dest, source->count);
+
+    return 1;
+}
+
+//Get the index just past the end of the band starting at index
+int Region_band_end(Region* region, int index) {
+
+    int top = region->rects[index].top;
+
+    for(index++; index < region->count && region->rects[index].top == top; index++);
+
+    return index;
+}
+
+//Append one span to the result being built in dest's scratch array
+int Region_emit(Region* dest, int* count, int top, int left, int bottom, int right) {
+
+    Rect* rect;
+
+    if(!Region_grow_spare(dest, *count + 1))
+        return 0;
+
+    rect = &dest->spare_rects[(*count)++];
+    rect->top = top;
+    rect->left = left;
+    rect->bottom = bottom;
+    rect->right = right;
+
+    return 1;
+}
+
+//Combine the spans of one band of a with one band of b (either of which
+//may be empty) into a new band covering top to bottom. The spans coming in
+//are sorted and separated, and the ones going out are too
+int Region_merge_band(Region* dest, int* count, int top, int bottom, int operation,
+                      Rect* a_span, Rect* a_end, Rect* b_span, Rect* b_end) {
+
+    int left, right;
+    Rect* next_span;
+
+    if(operation == REGION_UNION) {
+
+        //Always take whichever span starts first, and extend the span
+        //we're building for as long as the next one touches it
+        if(a_span < a_end && (b_span == b_end || a_span->left <= b_span->left))
+            next_span = a_span++;
+        else if(b_span < b_end)
+            next_span = b_span++;
+        else
+            return 1;
+
+        left = next_span->left;
+        right = next_span->right;
+
+        while(a_span < a_end || b_span < b_end) {
+
+            if(a_span < a_end && (b_span == b_end || a_span->left <= b_span->left))
+                next_span = a_span++;
+            else
+                next_span = b_span++;
+
+            if(next_span->left <= right + 1) {
+
+                if(next_span->right > right)
+                    right = next_span->right;
+
+                continue;
+            }
+
+            if(!Region_emit(dest, count, top, left, bottom, right))
+                return 0;
+
+            left = next_span->left;
+            right = next_span->right;
+        }
+
+        return Region_emit(dest, count, top, left, bottom, right);
+    }
+
+    if(operation == REGION_INTERSECT) {
+
+        //Walk both lists together, stepping past whichever span ends first
+        while(a_span < a_end && b_span < b_end) {
+
+            left = a_span->left > b_span->left ? a_span->left : b_span->left;
+            right = a_span->right < b_span->right ? a_span->right : b_span->right;
+
+            if(left <= right && !Region_emit(dest, count, top, left, bottom, right))
+                return 0;
+
+            if(a_span->right < b_span->right)
+                a_span++;
+            else
+                b_span++;
+        }
+
+        return 1;
+    }
+
+    //Subtraction: cut each span of a wherever the spans of b cover it
+    for(; a_span < a_end; a_span++) {
+
+        left = a_span->left;
+
+        //Spans of b entirely to the left of this span can't touch any
+        //of the following ones either
+        for(; b_span < b_end && b_span->right < left; b_span++);
+
+        for(next_span = b_span; next_span < b_end && next_span->left <= a_span->right; next_span++) {
+
+            if(next_span->left > left &&
+               !Region_emit(dest, count, top, left, bottom, next_span->left - 1))
+                return 0;
+
+            left = next_span->right + 1;
+        }
+
+        if(left <= a_span->right &&
+           !Region_emit(dest, count, top, left, bottom, a_span->right))
+            return 0;
+    }
+
+    return 1;
+}
+
+//Returns nonzero if the two rects share any pixels
+int Region_rects_overlap(Rect* rect_a, Rect* rect_b) {
+
+    return rect_a->left <= rect_b->right && rect_a->right >= rect_b->left &&
+           rect_a->top <= rect_b->bottom && rect_a->bottom >= rect_b->top;
+}
+
+//Returns nonzero if inner_rect is entirely inside of outer_rect
+int Region_rect_contains(Rect* outer_rect, Rect* inner_rect) {
+
+    return inner_rect->left >= outer_rect->left && inner_rect->right <= outer_rect->right &&
+           inner_rect->top >= outer_rect->top && inner_rect->bottom <= outer_rect->bottom;
+}
+
+//Sweep down both regions at once. At every y where either region starts or
+//ends a band we start a new output band and merge the spans of whichever
+//input bands cover it. Each new band is folded into the one above it if
+//they touch and have identical spans
+int Region_combine(Region* dest, Region* region_a, Region* region_b, int operation) {
+
+    int a_index = 0;
+    int b_index = 0;
+    int count = 0;
+    int last_band = -1;
+    int a_end, b_end, a_active, b_active, y, y_end, band, i;
+
+    if((!region_a->count && !region_b->count) ||
+       (operation == REGION_INTERSECT && (!region_a->count || !region_b->count))) {
+
+        dest->count = 0;
+        return 1;
+    }
+
+    //Start at the first band of either region. For an intersection, we can
+    //go straight to the first place where both regions have bands
+    if(operation == REGION_INTERSECT) {
+
+        y = region_a->extents.top > region_b->extents.top ?
+            region_a->extents.top : region_b->extents.top;
+        a_index = Region_find_band(region_a, y);
+        b_index = Region_find_band(region_b, y);
+    } else if(!region_a->count)
+        y = region_b->rects[0].top;
+    else if(!region_b->count || region_a->rects[0].top < region_b->rects[0].top)
+        y = region_a->rects[0].top;
+    else
+        y = region_b->rects[0].top;
+
+    while(1) {
+
+        //Move past any bands that ended above us
+        while(a_index < region_a->count && region_a->rects[a_index].bottom < y)
+            a_index = Region_band_end(region_a, a_index);
+
+        while(b_index < region_b->count && region_b->rects[b_index].bottom < y)
+            b_index = Region_band_end(region_b, b_index);
+
+        if(a_index == region_a->count && b_index == region_b->count)
+            break;
+
+        //Nothing can come out of an intersection or subtraction once
+        //the region being cut down has run out
+        if(operation != REGION_UNION && a_index == region_a->count)
+            break;
+
+        if(operation == REGION_INTERSECT && b_index == region_b->count)
+            break;
+
+        a_active = a_index < region_a->count && region_a->rects[a_index].top <= y;
+        b_active = b_index < region_b->count && region_b->rects[b_index].top <= y;
+
+        //Jump over a gap between bands
+        if(!a_active && !b_active) {
+
+            if(a_index == region_a->count)
+                y = region_b->rects[b_index].top;
+            else if(b_index == region_b->count || region_a->rects[a_index].top < region_b->rects[b_index].top)
+                y = region_a->rects[a_index].top;
+            else
+                y = region_b->rects[b_index].top;
+
+            continue;
+        }
+
+        //This output band lasts until the next time either input changes
+        y_end = a_active ? region_a->rects[a_index].bottom : region_b->rects[b_index].bottom;
+
+        if(a_index < region_a->count) {
+
+            i = a_active ? region_a->rects[a_index].bottom : region_a->rects[a_index].top - 1;
+
+            if(i < y_end)
+                y_end = i;
+        }
+
+        if(b_index < region_b->count) {
+
+            i = b_active ? region_b->rects[b_index].bottom : region_b->rects[b_index].top - 1;
+
+            if(i < y_end)
+                y_end = i;
+        }
+
+        a_end = a_active ? Region_band_end(region_a, a_index) : a_index;
+        b_end = b_active ? Region_band_end(region_b, b_index) : b_index;
+        band = count;
+
+        if(!Region_merge_band(dest, &count, y, y_end, operation,
+                              region_a->rects + a_index, region_a->rects + a_end,
+                              region_b->rects + b_index, region_b->rects + b_end))
+            return 0;
+
+        //Fold this band into the last one if they're the same shape
+        if(count > band) {
+
+            if(last_band >= 0 && dest->spare_rects[last_band].bottom == y - 1 &&
+               count - band == band - last_band) {
+
+                for(i = 0; i < band - last_band; i++)
+                    if(dest->spare_rects[last_band + i].left != dest->spare_rects[band + i].left ||
+                       dest->spare_rects[last_band + i].right != dest->spare_rects[band + i].right)
+                        break;
+
+                if(i == band - last_band) {
+
+                    for(i = last_band; i < band; i++)
+                        dest->spare_rects[i].bottom = y_end;
+
+                    count = band;
+                    band = last_band;
+                }
+            }
+
+            last_band = band;
+        }
+
+        y = y_end + 1;
+    }
+
+    Region_swap_spare(dest, count);
+
+    return 1;
+}
+
+int Region_union(Region* dest, Region* region_a, Region* region_b) {
+
+    return Region_combine(dest, region_a, region_b, REGION_UNION);
+}
+
+int Region_intersect(Region* dest, Region* region_a, Region* region_b) {
+
+    //Nothing in common
+    if(!region_a->count || !region_b->count ||
+       !Region_rects_overlap(&region_a->extents, &region_b->extents)) {
+
+        dest->count = 0;
+        return 1;
+    }
+
+    //Clipping a region to a rect it's already inside of leaves it alone
+    if(region_b->count == 1 && Region_rect_contains(&region_b->rects[0], &region_a->extents))
+        return Region_copy(dest, region_a);
+
+    if(region_a->count == 1 && Region_rect_contains(&region_a->rects[0], &region_b->extents))
+        return Region_copy(dest, region_b);
+
+    return Region_combine(dest, region_a, region_b, REGION_INTERSECT);
+}
+
+//dest = region_a with region_b cut out of it
+int Region_subtract(Region* dest, Region* region_a, Region* region_b) {
+
+    return Region_combine(dest, region_a, region_b, REGION_SUBTRACT);
+}
+
+//Wrap a single rect as a read-only region so it can go through the sweep
+void Region_from_rect(Region* region, Rect* rect) {
+
+    region->rects = rect;
+    region->count = (rect->top > rect->bottom || rect->left > rect->right) ? 0 : 1;
+    region->capacity = 0;
+    region->spare_rects = (Rect*)0;
+    region->spare_capacity = 0;
+    region->extents = *rect;
+    region->arena = (Arena*)0;
+}
+
+int Region_union_rect(Region* region, Rect* rect) {
+
+    Region rect_region;
+
+    if(!region->count)
+        return Region_set_rect(region, rect);
+
+    Region_from_rect(&rect_region, rect);
+
+    return Region_combine(region, region, &rect_region, REGION_UNION);
+}
+
+int Region_intersect_rect(Region* region, Rect* rect) {
+
+    Region rect_region;
+
+    if(!region->count)
+        return 1;
+
+    //Nothing to do if we're already inside of the rect
+    if(Region_rect_contains(rect, &region->extents))
+        return 1;
+
+    if(!Region_rects_overlap(&region->extents, rect)) {
+
+        region->count = 0;
+        return 1;
+    }
+
+    Region_from_rect(&rect_region, rect);
+
+    return Region_combine(region, region, &rect_region, REGION_INTERSECT);
+}
+
+int Region_subtract_rect(Region* region, Rect* rect) {
+
+    Region rect_region;
+
+    //Nothing to do if the rect misses us entirely
+    if(!region->count || !Region_rects_overlap(&region->extents, rect))
+        return 1;
+
+    Region_from_rect(&rect_region, rect);
+
+    return Region_combine(region, region, &rect_region, REGION_SUBTRACT);
+}
+
+//Shift the whole region over by the given amounts
+void Region_translate(Region* region, int x, int y) {
+
+    int i;
+
+    for(i = 0; i < region->count; i++) {
+
+        region->rects[i].top += y;
+        region->rects[i].left += x;
+        region->rects[i].bottom += y;
+        region->rects[i].right += x;
+    }
+
+    region->extents.top += y;
+    region->extents.left += x;
+    region->extents.bottom += y;
+    region->extents.right += x;
+}
+
+//Binary search for the first rect that reaches down to the given y or
+//further. The bottoms of the rects only ever increase from band to band,
+//so this is also the first rect of its band. Returns count if there's none
+int Region_find_band(Region* region, int top) {
+
+    int low = 0;
+    int high = region->count;
+    int middle;
+
+    while(low < high) {
+
+        middle = (low + high) / 2;
+
+        if(region->rects[middle].bottom < top)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+//Returns nonzero if any part of the rect is inside of the region
+int Region_intersects_rect(Region* region, Rect* rect) {
+
+    int i;
+
+    if(!region->count || !Region_rects_overlap(&region->extents, rect))
+        return 0;
+
+    for(i = Region_find_band(region, rect->top);
+        i < region->count && region->rects[i].top <= rect->bottom; i++)
+        if(region->rects[i].left <= rect->right && region->rects[i].right >= rect->left)
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "rect.h"
+#include "arena.h"
+
+//================| Region Class Declaration |================//
+
+//An arbitrary area of the screen, stored as a set of non-overlapping rects.
+//The rects are kept in y-x banded order: the region is cut into horizontal
+//bands, every rect in a band has the same top and bottom, bands are sorted
+//top to bottom and the rects within a band are sorted left to right. Bands
+//never touch a neighbor with the same spans (those get merged), and spans
+//in a band never touch each other, so there's only one way to store any
+//given area and the rect count stays as small as the shape allows.
+//
+//Because of that ordering, every boolean operation is a single linear pass
+//over both inputs, and finding the rects near a given y is a binary search
+typedef struct Region_struct {
+    Rect* rects;
+    int count;
+    int capacity;
+    Rect* spare_rects; //Scratch array the next operation builds its result in
+    int spare_capacity;
+    Rect extents; //Bounding box of the whole region, only valid if count > 0
+    Arena* arena; //Where our memory comes from, or null for the heap
+} Region;
+
+//Methods
+Region* Region_new();
+Region* Region_new_in(Arena* arena);
+void Region_delete(Region* region);
+void Region_clear(Region* region);
+int Region_set_rect(Region* region, Rect* rect);
+int Region_copy(Region* dest, Region* source);
+int Region_union(Region* dest, Region* region_a, Region* region_b);
+int Region_intersect(Region* dest, Region* region_a, Region* region_b);
+int Region_subtract(Region* dest, Region* region_a, Region* region_b);
+int Region_union_rect(Region* region, Rect* rect);
+int Region_intersect_rect(Region* region, Rect* rect);
+int Region_subtract_rect(Region* region, Rect* rect);
+void Region_translate(Region* region, int x, int y);
+int Region_find_band(Region* region, int top);
+int Region_intersects_rect(Region* region, Rect* rect);
+
+#endif //REGION_H
@@ -0,0 +1,483 @@
+#include <inttypes.h>
+#include <string.h>
+#include "span.h"
+
+#ifdef SPAN_HAVE_X86
+#include <immintrin.h>
+#endif
+
+
+//================| Span Kernel Implementation |================//
+
+//Starts out as the plain C version until Span_init finds something better
+SpanFillFunction span_fill_kernel = Span_fill_portable;
+SpanMaskFunction span_mask_kernel = Span_fill_masked_portable;
+SpanBitsFunction span_bits_kernel = Span_fill_bits_portable;
+
+#ifdef SPAN_HAVE_X86
+
+//How many pixels fit in an SSE2 register and in an AVX2 one
+#define SPAN_LANES (16 / PIXEL_BYTES)
+#define SPAN_WIDE_LANES (32 / PIXEL_BYTES)
+
+//A pixel repeated to fill 32 bits, for spreading across every lane
+#if PIXEL_BYTES == 4
+#define SPAN_REPEAT(pixel) ((uint32_t)(pixel))
+#elif PIXEL_BYTES == 2
+#define SPAN_REPEAT(pixel) ((uint32_t)(pixel) * 0x00010001u)
+#else
+#define SPAN_REPEAT(pixel) ((uint32_t)(pixel) * 0x01010101u)
+#endif
+#endif
+
+#ifdef SPAN_HAVE_AVX2_MASKS
+
+//Row n has its first n lanes set, for cutting a mask down to a shorter span
+uint32_t span_edge_masks[9][8] = {
+    { 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0xFFFFFFFF, 0, 0, 0, 0, 0, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0, 0, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF }
+};
+#endif
+
+//Pick the fastest fill the current CPU can run
+void Span_init(void) {
+
+#ifdef SPAN_HAVE_X86
+
+    //SSE2 is part of the x86-64 baseline, so only AVX2 needs checking for
+    span_fill_kernel = Span_fill_sse2;
+    span_mask_kernel = Span_fill_masked_sse2;
+    span_bits_kernel = Span_fill_bits_sse2;
+
+    if(Span_cpu_has_avx2()) {
+
+        span_fill_kernel = Span_fill_avx2;
+#ifdef SPAN_HAVE_AVX2_MASKS
+        span_mask_kernel = Span_fill_masked_avx2;
+        span_bits_kernel = Span_fill_bits_avx2;
+#endif
+    }
+#else
+
+    span_fill_kernel = Span_fill_portable;
+    span_mask_kernel = Span_fill_masked_portable;
+    span_bits_kernel = Span_fill_bits_portable;
+#endif
+}
+
+//Fill count pixels starting at dest with color
+void Span_fill(Pixel* dest, Pixel color, unsigned int count) {
+
+    span_fill_kernel(dest, color, count);
+}
+
+//Write color to each of the count pixels at dest whose mask pixel is set
+//(masks are all-ones or all-zeroes per pixel). This is how glyphs get drawn,
+//so count is never more than eight
+void Span_fill_masked(Pixel* dest, Pixel color, Pixel* mask, unsigned int count) {
+
+    span_mask_kernel(dest, color, mask, count);
+}
+
+//Like Span_fill_masked, but with one bit per pixel rather than a whole
+//pixel. Bit n of the span is bit first_bit + n of the bytes at bits, with
+//the high bit of each byte leftmost (the same as the font). Spans can be
+//any length, and the byte after the last one the span uses gets read too,
+//so whoever owns the bits needs to leave a spare byte at the end.
+//Returns how many pixels were filled, which is how many of the bits were set
+unsigned int Span_fill_bits(Pixel* dest, Pixel color, uint8_t* bits,
+                            unsigned int first_bit, unsigned int count) {
+
+    return span_bits_kernel(dest, color, bits, first_bit, count);
+}
+
+//How many bits are set in every possible byte
+#define SPAN_COUNT2(n) n, n + 1, n + 1, n + 2
+#define SPAN_COUNT4(n) SPAN_COUNT2(n), SPAN_COUNT2(n + 1), SPAN_COUNT2(n + 1), SPAN_COUNT2(n + 2)
+#define SPAN_COUNT6(n) SPAN_COUNT4(n), SPAN_COUNT4(n + 1), SPAN_COUNT4(n + 1), SPAN_COUNT4(n + 2)
+uint8_t span_bit_counts[256] = {
+    SPAN_COUNT6(0), SPAN_COUNT6(1), SPAN_COUNT6(1), SPAN_COUNT6(2)
+};
+
+//The eight bits starting at any bit, not just at the start of a byte
+uint8_t Span_bits_at(uint8_t* bits, unsigned int bit) {
+
+    bits += bit >> 3;
+
+    return (uint8_t)((((unsigned int)bits[0] << 8) | bits[1]) >> (8 - (bit & 7)));
+}
+
+//How many bits in a row are set from first_bit on, up to count, so that
+//they can all be filled at once. Only the rest of the first byte and the
+//start of the last one get looked at bit by bit, in between it's eight
+//bytes at a time while they're all set and then one byte at a time. A run
+//that doesn't reach the end of the span always stops at the end of a byte,
+//so the next one starts out lined up with the bytes
+unsigned int Span_set_run(uint8_t* bits, unsigned int first_bit, unsigned int count) {
+
+    unsigned int run, shift = first_bit & 7;
+    uint64_t word;
+
+    bits += first_bit >> 3;
+
+    if((uint8_t)(bits[0] << shift) != (uint8_t)(0xFF << shift))
+        return 0;
+
+    for(run = 8 - shift, bits++; run + 64 <= count; run += 64, bits += 8) {
+
+        memcpy(&word, bits, sizeof(word));
+
+        if(word != ~(uint64_t)0)
+            break;
+    }
+
+    for(; run + 8 <= count && *bits == 0xFF; run += 8, bits++);
+
+    if(run < count && count - run < 8 && (bits[0] | (0xFF >> (count - run))) == 0xFF)
+        return count;
+
+    return run < count ? run : count;
+}
+
+//The first byte's worth of bits (or less, at the end of a span) with any
+//bits past the end of the span cleared
+uint8_t Span_first_bits(uint8_t* bits, unsigned int first_bit, unsigned int count) {
+
+    return Span_bits_at(bits, first_bit) & (uint8_t)(0xFF << (8 - (count < 8 ? count : 8)));
+}
+
+//How many of count bits starting at first_bit are set
+unsigned int Span_count_bits(uint8_t* bits, unsigned int first_bit, unsigned int count) {
+
+    unsigned int total = 0;
+
+    for(; count >= 8; count -= 8, first_bit += 8)
+        total += span_bit_counts[Span_bits_at(bits, first_bit)];
+
+    if(count)
+        total += span_bit_counts[Span_first_bits(bits, first_bit, count)];
+
+    return total;
+}
+
+//Fill a rectangle of pixels, one span per row, where stride is the
+//distance in pixels from one row to the next
+void Span_fill_rect(Pixel* dest, unsigned int stride, Pixel color,
+                    unsigned int width, unsigned int height) {
+
+    Pixel *cur_pixel, *row_end;
+
+    //Skinny rects (vertical lines and borders, mostly) would spend more time
+    //calling the kernel than filling, so just do those right here
+    if(width < SPAN_MIN_KERNEL_WIDTH) {
+
+        for(; height; height--, dest += stride)
+            for(cur_pixel = dest, row_end = dest + width; cur_pixel < row_end; cur_pixel++)
+                *cur_pixel = color;
+
+        return;
+    }
+
+    for(; height; height--, dest += stride)
+        span_fill_kernel(dest, color, width);
+}
+
+//Works everywhere. Good compilers will vectorize this on their own, but
+//we can't count on that
+void Span_fill_portable(Pixel* dest, Pixel color, unsigned int count) {
+
+    Pixel* end = dest + count;
+
+    //Unroll by four to cut down on loop overhead
+    for(; dest + 4 <= end; dest += 4) {
+
+        dest[0] = color;
+        dest[1] = color;
+        dest[2] = color;
+        dest[3] = color;
+    }
+
+    for(; dest < end; dest++)
+        *dest = color;
+}
+
+void Span_fill_masked_portable(Pixel* dest, Pixel color,
+                               Pixel* mask, unsigned int count) {
+
+    for(; count; count--, dest++, mask++)
+        if(*mask)
+            *dest = color;
+}
+
+//Eight pixels to a byte of bits. A clip mask is mostly long runs of set
+//or clear bits, so whole bytes of set bits get filled like any other span
+//and only the bytes with both kinds get looked at bit by bit
+unsigned int Span_fill_bits_portable(Pixel* dest, Pixel color, uint8_t* bits,
+                                     unsigned int first_bit, unsigned int count) {
+
+    unsigned int i, run;
+    unsigned int filled = 0;
+    uint8_t byte;
+
+    for(; count; count -= run, dest += run, first_bit += run) {
+
+        if((run = Span_set_run(bits, first_bit, count))) {
+
+            Span_fill_portable(dest, color, run);
+            filled += run;
+            continue;
+        }
+
+        run = count < 8 ? count : 8;
+        byte = Span_first_bits(bits, first_bit, count);
+        filled += span_bit_counts[byte];
+
+        for(i = 0; i < run; i++)
+            if(byte & (0x80 >> i))
+                dest[i] = color;
+    }
+
+    return filled;
+}
+
+#ifdef SPAN_HAVE_X86
+
+int Span_cpu_has_avx2(void) {
+
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2");
+}
+
+//16 bytes of pixels per store. We do single pixels until the destination
+//is 16-byte aligned so that all of the wide stores can be aligned ones
+__attribute__((target("sse2")))
+void Span_fill_sse2(Pixel* dest, Pixel color, unsigned int count) {
+
+    Pixel* end = dest + count;
+    __m128i wide_color = _mm_set1_epi32((int)SPAN_REPEAT(color));
+
+    for(; dest < end && ((uintptr_t)dest & 15); dest++)
+        *dest = color;
+
+    //Main loop does four stores per pass
+    for(; dest + 4 * SPAN_LANES <= end; dest += 4 * SPAN_LANES) {
+
+        _mm_store_si128((__m128i*)dest, wide_color);
+        _mm_store_si128((__m128i*)(dest + SPAN_LANES), wide_color);
+        _mm_store_si128((__m128i*)(dest + 2 * SPAN_LANES), wide_color);
+        _mm_store_si128((__m128i*)(dest + 3 * SPAN_LANES), wide_color);
+    }
+
+    for(; dest + SPAN_LANES <= end; dest += SPAN_LANES)
+        _mm_store_si128((__m128i*)dest, wide_color);
+
+    for(; dest < end; dest++)
+        *dest = color;
+}
+
+//Same idea with 32 bytes per store and 32-byte alignment
+__attribute__((target("avx2")))
+void Span_fill_avx2(Pixel* dest, Pixel color, unsigned int count) {
+
+    Pixel* end = dest + count;
+    __m256i wide_color = _mm256_set1_epi32((int)SPAN_REPEAT(color));
+
+    //Short spans (think borders and lines) aren't worth the setup
+    if(count < 2 * SPAN_WIDE_LANES) {
+
+        for(; dest < end; dest++)
+            *dest = color;
+
+        return;
+    }
+
+    for(; (uintptr_t)dest & 31; dest++)
+        *dest = color;
+
+    //Main loop does four stores per pass
+    for(; dest + 4 * SPAN_WIDE_LANES <= end; dest += 4 * SPAN_WIDE_LANES) {
+
+        _mm256_store_si256((__m256i*)dest, wide_color);
+        _mm256_store_si256((__m256i*)(dest + SPAN_WIDE_LANES), wide_color);
+        _mm256_store_si256((__m256i*)(dest + 2 * SPAN_WIDE_LANES), wide_color);
+        _mm256_store_si256((__m256i*)(dest + 3 * SPAN_WIDE_LANES), wide_color);
+    }
+
+    for(; dest + SPAN_WIDE_LANES <= end; dest += SPAN_WIDE_LANES)
+        _mm256_store_si256((__m256i*)dest, wide_color);
+
+    for(; dest < end; dest++)
+        *dest = color;
+}
+
+//SSE2 has no masked store that isn't also non-temporal, so we blend a
+//register's worth of pixels at a time instead. Only whole registers that
+//fit inside the span are done that way, so we never touch a pixel past the
+//end of it
+__attribute__((target("sse2")))
+void Span_fill_masked_sse2(Pixel* dest, Pixel color,
+                           Pixel* mask, unsigned int count) {
+
+    __m128i wide_color = _mm_set1_epi32((int)SPAN_REPEAT(color));
+    __m128i wide_mask, pixels;
+
+    for(; count >= SPAN_LANES; count -= SPAN_LANES, dest += SPAN_LANES, mask += SPAN_LANES) {
+
+        wide_mask = _mm_loadu_si128((__m128i*)mask);
+        pixels = _mm_loadu_si128((__m128i*)dest);
+        pixels = _mm_or_si128(_mm_and_si128(wide_mask, wide_color),
+                              _mm_andnot_si128(wide_mask, pixels));
+        _mm_storeu_si128((__m128i*)dest, pixels);
+    }
+
+    for(; count; count--, dest++, mask++)
+        if(*mask)
+            *dest = color;
+}
+
+#ifdef SPAN_HAVE_AVX2_MASKS
+
+//A whole glyph row in one masked store. Lanes past the end of the span are
+//masked off too, and masked-off lanes are never touched, so this is safe
+//right up against the end of the framebuffer
+__attribute__((target("avx2")))
+void Span_fill_masked_avx2(Pixel* dest, Pixel color,
+                           Pixel* mask, unsigned int count) {
+
+    __m256i wide_mask;
+
+    if(count > 8)
+        count = 8;
+
+    wide_mask = _mm256_and_si256(_mm256_loadu_si256((__m256i*)mask),
+                                 _mm256_loadu_si256((__m256i*)span_edge_masks[count]));
+    _mm256_maskstore_epi32((int*)dest, wide_mask, _mm256_set1_epi32((int)color));
+}
+#endif
+
+//Bytes with both set and clear bits get spread out into lane masks by
+//testing a different bit in every lane, and then blended in like
+//Span_fill_masked_sse2 does. That's two four-lane masks for 32-bit pixels
+//and one eight-lane one for 16-bit pixels, while 8-bit pixels would need
+//the bits spread across sixteen lanes for only eight pixels, so they just
+//get done one at a time. A last partial byte gets done one pixel at a time
+//for the same reason as in Span_fill_masked_sse2
+__attribute__((target("sse2")))
+unsigned int Span_fill_bits_sse2(Pixel* dest, Pixel color, uint8_t* bits,
+                                 unsigned int first_bit, unsigned int count) {
+
+#if PIXEL_BYTES == 4
+    __m128i wide_color = _mm_set1_epi32((int)color);
+    __m128i low_lane_bits = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+    __m128i high_lane_bits = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+    __m128i wide_bits, wide_mask, pixels;
+#elif PIXEL_BYTES == 2
+    __m128i wide_color = _mm_set1_epi16((short)color);
+    __m128i lane_bits = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m128i wide_bits, wide_mask, pixels;
+#else
+    unsigned int i;
+#endif
+    unsigned int run;
+    unsigned int filled = 0;
+    uint8_t byte;
+
+    for(; count >= 8; count -= run, dest += run, first_bit += run) {
+
+        if((run = Span_set_run(bits, first_bit, count))) {
+
+            Span_fill_sse2(dest, color, run);
+            filled += run;
+            continue;
+        }
+
+        run = 8;
+        byte = Span_bits_at(bits, first_bit);
+
+        if(!byte)
+            continue;
+
+        filled += span_bit_counts[byte];
+#if PIXEL_BYTES == 4
+        wide_bits = _mm_set1_epi32(byte);
+        wide_mask = _mm_cmpeq_epi32(_mm_and_si128(wide_bits, low_lane_bits), low_lane_bits);
+        pixels = _mm_loadu_si128((__m128i*)dest);
+        pixels = _mm_or_si128(_mm_and_si128(wide_mask, wide_color),
+                              _mm_andnot_si128(wide_mask, pixels));
+        _mm_storeu_si128((__m128i*)dest, pixels);
+
+        wide_mask = _mm_cmpeq_epi32(_mm_and_si128(wide_bits, high_lane_bits), high_lane_bits);
+        pixels = _mm_loadu_si128((__m128i*)(dest + 4));
+        pixels = _mm_or_si128(_mm_and_si128(wide_mask, wide_color),
+                              _mm_andnot_si128(wide_mask, pixels));
+        _mm_storeu_si128((__m128i*)(dest + 4), pixels);
+#elif PIXEL_BYTES == 2
+        wide_bits = _mm_set1_epi16(byte);
+        wide_mask = _mm_cmpeq_epi16(_mm_and_si128(wide_bits, lane_bits), lane_bits);
+        pixels = _mm_loadu_si128((__m128i*)dest);
+        pixels = _mm_or_si128(_mm_and_si128(wide_mask, wide_color),
+                              _mm_andnot_si128(wide_mask, pixels));
+        _mm_storeu_si128((__m128i*)dest, pixels);
+#else
+        for(i = 0; i < 8; i++)
+            if(byte & (0x80 >> i))
+                dest[i] = color;
+#endif
+    }
+
+    if(count)
+        filled += Span_fill_bits_portable(dest, color, bits, first_bit, count);
+
+    return filled;
+}
+
+#ifdef SPAN_HAVE_AVX2_MASKS
+
+//One masked store for each byte with both set and clear bits, spread out
+//across the lanes the same way as for SSE2. The last partial byte has the
+//bits past the end of the span cleared, so it's just another masked store
+__attribute__((target("avx2")))
+unsigned int Span_fill_bits_avx2(Pixel* dest, Pixel color, uint8_t* bits,
+                                 unsigned int first_bit, unsigned int count) {
+
+    __m256i wide_color = _mm256_set1_epi32((int)color);
+    __m256i lane_bits = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m256i wide_mask;
+    unsigned int run;
+    unsigned int filled = 0;
+    uint8_t byte;
+
+    for(; count; count -= run, dest += run, first_bit += run) {
+
+        if((run = Span_set_run(bits, first_bit, count))) {
+
+            Span_fill_avx2(dest, color, run);
+            filled += run;
+            continue;
+        }
+
+        run = count < 8 ? count : 8;
+        byte = Span_first_bits(bits, first_bit, count);
+
+        if(!byte)
+            continue;
+
+        filled += span_bit_counts[byte];
+        wide_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), lane_bits),
+                                       lane_bits);
+        _mm256_maskstore_epi32((int*)dest, wide_mask, wide_color);
+    }
+
+    return filled;
+}
+#endif
+
+#endif //SPAN_HAVE_X86
@@ -0,0 +1,65 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <inttypes.h>
+#include "pixel.h"
+
+//================| Span Kernels |================//
+
+//Low-level pixel routines that work on a single horizontal run of pixels.
+//Every filled rectangle ends up as a stack of these, so they come in a few
+//flavors and the fastest one the CPU supports is picked at runtime. They're
+//all compiled for the pixel format being built for (see pixel.h)
+
+typedef void (*SpanFillFunction)(Pixel* dest, Pixel color, unsigned int count);
+typedef void (*SpanMaskFunction)(Pixel* dest, Pixel color,
+                                 Pixel* mask, unsigned int count);
+typedef unsigned int (*SpanBitsFunction)(Pixel* dest, Pixel color, uint8_t* bits,
+                                         unsigned int first_bit, unsigned int count);
+
+//Spans narrower than this are filled inline rather than through a kernel
+#define SPAN_MIN_KERNEL_WIDTH 8
+
+//Methods
+void Span_init(void);
+void Span_fill(Pixel* dest, Pixel color, unsigned int count);
+void Span_fill_rect(Pixel* dest, unsigned int stride, Pixel color,
+                    unsigned int width, unsigned int height);
+void Span_fill_portable(Pixel* dest, Pixel color, unsigned int count);
+void Span_fill_masked(Pixel* dest, Pixel color, Pixel* mask, unsigned int count);
+void Span_fill_masked_portable(Pixel* dest, Pixel color,
+                               Pixel* mask, unsigned int count);
+unsigned int Span_fill_bits(Pixel* dest, Pixel color, uint8_t* bits,
+                            unsigned int first_bit, unsigned int count);
+unsigned int Span_fill_bits_portable(Pixel* dest, Pixel color, uint8_t* bits,
+                                     unsigned int first_bit, unsigned int count);
+unsigned int Span_count_bits(uint8_t* bits, unsigned int first_bit, unsigned int count);
+
+//The vector versions only exist on x86 builds
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPAN_HAVE_X86 1
+void Span_fill_sse2(Pixel* dest, Pixel color, unsigned int count);
+void Span_fill_avx2(Pixel* dest, Pixel color, unsigned int count);
+void Span_fill_masked_sse2(Pixel* dest, Pixel color,
+                           Pixel* mask, unsigned int count);
+unsigned int Span_fill_bits_sse2(Pixel* dest, Pixel color, uint8_t* bits,
+                                 unsigned int first_bit, unsigned int count);
+int Span_cpu_has_avx2(void);
+
+//AVX2 only has masked stores for 32- and 64-bit lanes, so the masked
+//versions are only any use with 32-bit pixels
+#if PIXEL_BYTES == 4
+#define SPAN_HAVE_AVX2_MASKS 1
+void Span_fill_masked_avx2(Pixel* dest, Pixel color,
+                           Pixel* mask, unsigned int count);
+unsigned int Span_fill_bits_avx2(Pixel* dest, Pixel color, uint8_t* bits,
+                                 unsigned int first_bit, unsigned int count);
+#endif
+#endif
+
+//The currently selected kernels (exposed so benchmarks can swap them out)
+extern SpanFillFunction span_fill_kernel;
+extern SpanMaskFunction span_mask_kernel;
+extern SpanBitsFunction span_bits_kernel;
+
+#endif //SPAN_H
@@ -0,0 +1,275 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "spatialgrid.h"
+
+//================| SpatialGrid Class Implementation |================//
+
+//Starting size of a cell's entry list
+#define SPATIALGRID_MIN_CAPACITY 4
+
+//Where z values start out
+#define SPATIALGRID_MIDDLE_Z 0x80000000
+
+//Create a grid covering an area of the given size
+SpatialGrid* SpatialGrid_new(int width, int height) {
+
+    SpatialGrid* grid;
+    if(!(grid = (SpatialGrid*)malloc(sizeof(SpatialGrid))))
+        return grid;
+
+    //Always at least one cell, even for an empty area
+    grid->columns = width > 0 ? (width + SPATIALGRID_CELL_SIZE - 1) / SPATIALGRID_CELL_SIZE : 1;
+    grid->rows = height > 0 ? (height + SPATIALGRID_CELL_SIZE - 1) / SPATIALGRID_CELL_SIZE : 1;
+    grid->entry_count = 0;
+
+    //Start in the middle so there's room to go both up and down
+    grid->next_z = SPATIALGRID_MIDDLE_Z;
+    grid->bottom_z = SPATIALGRID_MIDDLE_Z - 1;
+    grid->stamp = 0;
+
+    if(!(grid->cells = (SpatialGridCell*)calloc(grid->columns * grid->rows,
+                                                 sizeof(SpatialGridCell)))) {
+
+        free(grid);
+        return (SpatialGrid*)0;
+    }
+
+    return grid;
+}
+
+void SpatialGrid_delete(SpatialGrid* grid) {
+
+    int i;
+
+    for(i = 0; i < grid->columns * grid->rows; i++)
+        free(grid->cells[i].entries);
+
+    free(grid->cells);
+    free(grid);
+}
+
+//Which column or row a coordinate falls in, counting anything off the
+//edges as being in the edge cells
+int SpatialGrid_column(SpatialGrid* grid, int x) {
+
+    if(x < 0)
+        return 0;
+
+    x /= SPATIALGRID_CELL_SIZE;
+
+    return x < grid->columns ? x : grid->columns - 1;
+}
+
+int SpatialGrid_row(SpatialGrid* grid, int y) {
+
+    if(y < 0)
+        return 0;
+
+    y /= SPATIALGRID_CELL_SIZE;
+
+    return y < grid->rows ? y : grid->rows - 1;
+}
+
+//List the entry in every cell its rect touches. Makes room in all of them
+//first, so that the entry is either listed everywhere or nowhere
+//Returns zero if we ran out of memory
+int SpatialGrid_place(SpatialGrid* grid, SpatialGridEntry* entry) {
+
+    int row, column, new_capacity;
+    SpatialGridCell* cell;
+    SpatialGridEntry** new_entries;
+
+    entry->cell_top = SpatialGrid_row(grid, entry->rect.top);
+    entry->cell_left = SpatialGrid_column(grid, entry->rect.left);
+    entry->cell_bottom = SpatialGrid_row(grid, entry->rect.bottom);
+    entry->cell_right = SpatialGrid_column(grid, entry->rect.right);
+
+    for(row = entry->cell_top; row <= entry->cell_bottom; row++) {
+
+        for(column = entry->cell_left; column <= entry->cell_right; column++) {
+
+            cell = &grid->cells[row * grid->columns + column];
+
+            if(cell->count < cell->capacity)
+                continue;
+
+            new_capacity = cell->capacity ? cell->capacity * 2 : SPATIALGRID_MIN_CAPACITY;
+
+            if(!(new_entries = (SpatialGridEntry**)realloc(cell->entries,
+                                                           sizeof(SpatialGridEntry*) * new_capacity)))
+                return 0;
+
+            cell->entries = new_entries;
+            cell->capacity = new_capacity;
+        }
+    }
+
+    for(row = entry->cell_top; row <= entry->cell_bottom; row++) {
+
+        for(column = entry->cell_left; column <= entry->cell_right; column++) {
+
+            cell = &grid->cells[row * grid->columns + column];
+            cell->entries[cell->count++] = entry;
+        }
+    }
+
+    entry->in_grid = 1;
+    grid->entry_count++;
+
+    return 1;
+}
+
+//Take the entry back out of every cell it's listed in
+void SpatialGrid_remove(SpatialGrid* grid, SpatialGridEntry* entry) {
+
+    int row, column, i;
+    SpatialGridCell* cell;
+
+    if(!entry->in_grid)
+        return;
+
+    for(row = entry->cell_top; row <= entry->cell_bottom; row++) {
+
+        for(column = entry->cell_left; column <= entry->cell_right; column++) {
+
+            cell = &grid->cells[row * grid->columns + column];
+
+            //Order within a cell doesn't matter, so fill the hole with the last one
+            for(i = 0; i < cell->count; i++) {
+
+                if(cell->entries[i] == entry) {
+
+                    cell->entries[i] = cell->entries[--cell->count];
+                    break;
+                }
+            }
+        }
+    }
+
+    entry->in_grid = 0;
+    grid->entry_count--;
+}
+
+//Add an entry for item at rect, on top of everything already in the grid
+//Returns zero if we ran out of memory, in which case it wasn't added
+int SpatialGrid_insert(SpatialGrid* grid, SpatialGridEntry* entry, void* item, Rect* rect) {
+
+    entry->item = item;
+    entry->rect = *rect;
+    entry->z = grid->next_z++;
+    entry->stamp = grid->stamp;
+
+    return SpatialGrid_place(grid, entry);
+}
+
+//Update the position of an entry, keeping its place in the stack
+//Returns zero if we ran out of memory, in which case the entry is no longer
+//in the grid
+int SpatialGrid_move(SpatialGrid* grid, SpatialGridEntry* entry, Rect* rect) {
+
+    //Most moves are small enough to stay in the same cells
+    if(entry->in_grid &&
+       SpatialGrid_row(grid, rect->top) == entry->cell_top &&
+       SpatialGrid_column(grid, rect->left) == entry->cell_left &&
+       SpatialGrid_row(grid, rect->bottom) == entry->cell_bottom &&
+       SpatialGrid_column(grid, rect->right) == entry->cell_right) {
+
+        entry->rect = *rect;
+        return 1;
+    }
+
+    SpatialGrid_remove(grid, entry);
+    entry->rect = *rect;
+
+    return SpatialGrid_place(grid, entry);
+}
+
+//Put an entry on top of all of the others
+void SpatialGrid_raise(SpatialGrid* grid, SpatialGridEntry* entry) {
+
+    entry->z = grid->next_z++;
+}
+
+//Put an entry under all of the others
+void SpatialGrid_lower(SpatialGrid* grid, SpatialGridEntry* entry) {
+
+    entry->z = grid->bottom_z--;
+}
+
+//Find the highest entry whose rect contains the point, or null if none do
+SpatialGridEntry* SpatialGrid_topmost_at(SpatialGrid* grid, int x, int y) {
+
+    int i;
+    SpatialGridEntry *entry, *topmost = (SpatialGridEntry*)0;
+    SpatialGridCell* cell;
+
+    cell = &grid->cells[SpatialGrid_row(grid, y) * grid->columns + SpatialGrid_column(grid, x)];
+
+    for(i = 0; i < cell->count; i++) {
+
+        entry = cell->entries[i];
+
+        if(x >= entry->rect.left && x <= entry->rect.right &&
+           y >= entry->rect.top && y <= entry->rect.bottom &&
+           (!topmost || entry->z > topmost->z))
+            topmost = entry;
+    }
+
+    return topmost;
+}
+
+//Find every entry between min_z and max_z (inclusive) whose rect touches the
+//passed one. The results come back bottom to top in an array allocated
+//from the arena, with their number in count. Returns null on failure
+SpatialGridEntry** SpatialGrid_query(SpatialGrid* grid, Rect* rect, uint32_t min_z,
+                                     uint32_t max_z, Arena* arena, int* count) {
+
+    int row, column, i, j, bottom, right;
+    SpatialGridEntry **results, *entry;
+    SpatialGridCell* cell;
+
+    *count = 0;
+
+    //There can't be more results than there are entries
+    if(!(results = (SpatialGridEntry**)Arena_alloc(arena, sizeof(SpatialGridEntry*) *
+                                                        (grid->entry_count + 1))))
+        return results;
+
+    //Entries spanning several cells get seen more than once, so mark
+    //each one with this query's stamp the first time around
+    grid->stamp++;
+    bottom = SpatialGrid_row(grid, rect->bottom);
+    right = SpatialGrid_column(grid, rect->right);
+
+    for(row = SpatialGrid_row(grid, rect->top); row <= bottom; row++) {
+
+        for(column = SpatialGrid_column(grid, rect->left); column <= right; column++) {
+
+            cell = &grid->cells[row * grid->columns + column];
+
+            for(i = 0; i < cell->count; i++) {
+
+                entry = cell->entries[i];
+
+                if(entry->stamp == grid->stamp)
+                    continue;
+
+                entry->stamp = grid->stamp;
+
+                if(entry->z < min_z || entry->z > max_z ||
+                   entry->rect.left > rect->right || entry->rect.right < rect->left ||
+                   entry->rect.top > rect->bottom || entry->rect.bottom < rect->top)
+                    continue;
+
+                //Insertion sort, since there are only ever a few results
+                for(j = *count; j > 0 && results[j - 1]->z > entry->z; j--)
+                    results[j] = results[j - 1];
+
+                results[j] = entry;
+                (*count)++;
+            }
+        }
+    }
+
+    return results;
+}
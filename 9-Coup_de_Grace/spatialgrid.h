@@ -0,0 +1,65 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <inttypes.h>
+#include "rect.h"
+#include "arena.h"
+
+//================| SpatialGrid Class Declaration |================//
+
+//A uniform grid over an area for quickly finding which of a set of
+//stacked rects are at a point or touching another rect. Every cell of the
+//grid lists the entries whose rects touch it, so a lookup only has to look
+//at the handful of entries in the cells it covers instead of all of them.
+//
+//Entries are owned by whoever put them in (a window keeps its own) and
+//carry a z value saying how high up the stack they are. Raising an entry
+//just gives it a new z higher than all the others (and lowering one a z
+//lower than all the others), so it never has to be moved between cells.
+//Anything outside of the grid's area is treated as being in the nearest
+//edge cell, so entries hanging off the edges are still found
+
+//Cells are this many pixels on a side
+#define SPATIALGRID_CELL_SIZE 64
+
+typedef struct SpatialGridEntry_struct {
+    void* item; //Whatever this entry stands for
+    Rect rect; //Where it is, in the grid's coordinates
+    uint32_t z; //Higher is closer to the top
+    uint32_t stamp; //Last query that saw this entry, to report it only once
+    uint8_t in_grid;
+    int cell_top; //The range of cells we're listed in
+    int cell_left;
+    int cell_bottom;
+    int cell_right;
+} SpatialGridEntry;
+
+typedef struct SpatialGridCell_struct {
+    SpatialGridEntry** entries;
+    int count;
+    int capacity;
+} SpatialGridCell;
+
+typedef struct SpatialGrid_struct {
+    int columns;
+    int rows;
+    SpatialGridCell* cells;
+    int entry_count;
+    uint32_t next_z; //Next z for something going on top
+    uint32_t bottom_z; //Next z for something going on the bottom
+    uint32_t stamp;
+} SpatialGrid;
+
+//Methods
+SpatialGrid* SpatialGrid_new(int width, int height);
+void SpatialGrid_delete(SpatialGrid* grid);
+int SpatialGrid_insert(SpatialGrid* grid, SpatialGridEntry* entry, void* item, Rect* rect);
+void SpatialGrid_remove(SpatialGrid* grid, SpatialGridEntry* entry);
+int SpatialGrid_move(SpatialGrid* grid, SpatialGridEntry* entry, Rect* rect);
+void SpatialGrid_raise(SpatialGrid* grid, SpatialGridEntry* entry);
+void SpatialGrid_lower(SpatialGrid* grid, SpatialGridEntry* entry);
+SpatialGridEntry* SpatialGrid_topmost_at(SpatialGrid* grid, int x, int y);
+SpatialGridEntry** SpatialGrid_query(SpatialGrid* grid, Rect* rect, uint32_t min_z,
+                                     uint32_t max_z, Arena* arena, int* count);
+
+#endif //SPATIALGRID_H
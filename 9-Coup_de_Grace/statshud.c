@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "statshud.h"
+
+//================| StatsHud Class Implementation |================//
+
+#define STATSHUD_BGCOLOR 0xFF202020
+#define STATSHUD_TEXTCOLOR 0xFF80FF80
+
+StatsHud* StatsHud_new(int x, int y) {
+
+    StatsHud* hud;
+    if(!(hud = (StatsHud*)malloc(sizeof(StatsHud))))
+        return hud;
+
+    if(!Window_init((Window*)hud, x, y, STATSHUD_WIDTH, STATSHUD_HEIGHT,
+                    WIN_NODECORATION, (Context*)0)) {
+
+        free(hud);
+        return (StatsHud*)0;
+    }
+
+    hud->window.paint_function = StatsHud_paint;
+
+    hud->stats.pixels_written = 0;
+    hud->stats.overdraw = 0;
+    hud->stats.clip_rects_processed = 0;
+    hud->stats.clip_rects_split = 0;
+    hud->stats.clip_rects_created = 0;
+    hud->stats.paint_calls = 0;
+    hud->stats.windows_painted = 0;
+
+    return hud;
+}
+
+//Write one labelled number on the given line of the HUD
+void StatsHud_draw_line(Window* hud_window, int line, char* label, unsigned long value) {
+
+    char text[32];
+
+    snprintf(text, sizeof(text), "%-16s%lu", label, value);
+    Context_draw_text(hud_window->context, text, 4, 4 + (line * 12), STATSHUD_TEXTCOLOR);
+}
+
+void StatsHud_paint(Window* hud_window) {
+
+    StatsHud* hud = (StatsHud*)hud_window;
+
+    Context_fill_rect(hud_window->context, 0, 0, hud_window->width,
+                      hud_window->height, STATSHUD_BGCOLOR);
+
+    StatsHud_draw_line(hud_window, 0, "pixels written", hud->stats.pixels_written);
+    StatsHud_draw_line(hud_window, 1, "overdraw", hud->stats.overdraw);
+    StatsHud_draw_line(hud_window, 2, "clip rects used", hud->stats.clip_rects_processed);
+    StatsHud_draw_line(hud_window, 3, "clip rects cut", hud->stats.clip_rects_split);
+    StatsHud_draw_line(hud_window, 4, "clip rects made", hud->stats.clip_rects_created);
+    StatsHud_draw_line(hud_window, 5, "paint handlers", hud->stats.paint_calls);
+    StatsHud_draw_line(hud_window, 6, "windows painted", hud->stats.windows_painted);
+}
+
+//Show a new set of numbers, making sure we're still on top of everything
+//else so that they can be seen
+void StatsHud_update(StatsHud* hud, ContextStats* stats) {
+
+    Window* hud_window = (Window*)hud;
+
+    hud->stats = *stats;
+
+    if(hud_window->parent && hud_window->parent->last_child != hud_window)
+        Window_raise(hud_window, 0);
+
+    Window_invalidate(hud_window, 0, 0, hud_window->height - 1, hud_window->width - 1);
+}
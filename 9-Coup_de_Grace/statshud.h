@@ -0,0 +1,24 @@
+#ifndef STATSHUD_H
+#define STATSHUD_H
+
+#include "window.h"
+
+//================| StatsHud Class Declaration |================//
+
+//A little undecorated window that shows the drawing work counted by a
+//context, so you can watch what an operation costs while you do it
+
+#define STATSHUD_WIDTH 200
+#define STATSHUD_HEIGHT 92
+
+typedef struct StatsHud_struct {
+    Window window;
+    ContextStats stats; //The numbers currently on display
+} StatsHud;
+
+//Methods
+StatsHud* StatsHud_new(int x, int y);
+void StatsHud_paint(Window* hud_window);
+void StatsHud_update(StatsHud* hud, ContextStats* stats);
+
+#endif //STATSHUD_H
@@ -0,0 +1,148 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "swapchain.h"
+
+//================| SwapChain Class Implementation |================//
+
+void SwapChain_acquire(SwapChain* swap_chain);
+
+//Set up buffer_count framebuffers and point the context at the first one
+//to draw into (which also sets its size). Null if fake_os couldn't do it,
+//in which case the context is left alone
+SwapChain* SwapChain_new(Context* context, int buffer_count) {
+
+    int i;
+    SwapChain* swap_chain;
+
+    if(!(swap_chain = (SwapChain*)malloc(sizeof(SwapChain))))
+        return swap_chain;
+
+    if(!(swap_chain->stale_region = Region_new())) {
+
+        free(swap_chain);
+        return (SwapChain*)0;
+    }
+
+    if(!fake_os_createSwapChain(buffer_count, &context->width, &context->height)) {
+
+        Region_delete(swap_chain->stale_region);
+        free(swap_chain);
+        return (SwapChain*)0;
+    }
+
+    swap_chain->context = context;
+    swap_chain->front = (Pixel*)0;
+
+    for(i = 0; i < SWAPCHAIN_HISTORY; i++)
+        swap_chain->history_counts[i] = 0;
+
+    SwapChain_acquire(swap_chain);
+
+    return swap_chain;
+}
+
+void SwapChain_delete(SwapChain* swap_chain) {
+
+    //The context borrows our stale region
+    swap_chain->context->stale_region = (Region*)0;
+    swap_chain->context->stale_source = (Pixel*)0;
+
+    Region_delete(swap_chain->stale_region);
+    free(swap_chain);
+}
+
+//Work out what the back buffer is missing: everything, if it has never
+//been shown (or has somehow fallen further behind than we keep track of),
+//otherwise the damage of the last age - 1 frames. It's worked out as a
+//region so that areas damaged in more than one of those frames only get
+//copied once
+int SwapChain_find_stale(SwapChain* swap_chain, int age) {
+
+    int i, j, unioned = 1;
+    Rect screen_rect;
+
+    Region_clear(swap_chain->stale_region);
+
+    if(age && age - 1 <= SWAPCHAIN_HISTORY) {
+
+        for(i = 0; unioned && i < age - 1; i++)
+            for(j = 0; unioned && j < swap_chain->history_counts[i]; j++)
+                unioned = Region_union_rect(swap_chain->stale_region, &swap_chain->history[i][j]);
+
+        if(unioned)
+            return 1;
+    }
+
+    screen_rect.top = 0;
+    screen_rect.left = 0;
+    screen_rect.bottom = swap_chain->context->height - 1;
+    screen_rect.right = swap_chain->context->width - 1;
+
+    return Region_set_rect(swap_chain->stale_region, &screen_rect);
+}
+
+//Point the context at the next buffer to draw into, and tell it what that
+//buffer missed. None of it gets copied over from the screen yet, since most
+//of it usually gets painted over again anyway (see Context_mark_current)
+void SwapChain_acquire(SwapChain* swap_chain) {
+
+    int age;
+    Context* context = swap_chain->context;
+
+    context->buffer = fake_os_acquireBuffer(&age);
+
+    //Nothing's been shown yet, so there's nothing to catch up on
+    if(!swap_chain->front || age == 1)
+        return;
+
+    context->stale_region = swap_chain->stale_region;
+    context->stale_source = swap_chain->front;
+
+    //If even the whole screen can't be worked out, copy it all now without
+    //bothering with a region
+    if(!SwapChain_find_stale(swap_chain, age)) {
+
+        Region_clear(swap_chain->stale_region);
+        memcpy(context->buffer, swap_chain->front, sizeof(Pixel) * context->width * context->height);
+        context->caught_up_pixels += context->width * context->height;
+    }
+}
+
+//Flip to the back buffer, showing the damage drawn into it, then get the
+//next back buffer ready to draw into
+void SwapChain_present(SwapChain* swap_chain) {
+
+    int i;
+    fo_rect present_rects[CONTEXT_MAX_DAMAGE];
+    Context* context = swap_chain->context;
+
+    //Whatever this frame didn't paint over has to match the screen before
+    //it goes up in its place
+    Context_catch_up_all(context);
+
+    //The oldest frame's damage falls off the end
+    for(i = SWAPCHAIN_HISTORY - 1; i > 0; i--) {
+
+        memcpy(swap_chain->history[i], swap_chain->history[i - 1],
+               sizeof(Rect) * swap_chain->history_counts[i - 1]);
+        swap_chain->history_counts[i] = swap_chain->history_counts[i - 1];
+    }
+
+    memcpy(swap_chain->history[0], context->damage_rects, sizeof(Rect) * context->damage_count);
+    swap_chain->history_counts[0] = context->damage_count;
+
+    for(i = 0; i < context->damage_count; i++) {
+
+        present_rects[i].x = context->damage_rects[i].left;
+        present_rects[i].y = context->damage_rects[i].top;
+        present_rects[i].width = context->damage_rects[i].right - context->damage_rects[i].left + 1;
+        present_rects[i].height = context->damage_rects[i].bottom - context->damage_rects[i].top + 1;
+    }
+
+    fake_os_swapBuffers(present_rects, context->damage_count);
+    Context_clear_damage(context);
+
+    swap_chain->front = context->buffer;
+    SwapChain_acquire(swap_chain);
+}
@@ -0,0 +1,39 @@
+#ifndef SWAPCHAIN_H
+#define SWAPCHAIN_H
+
+#include <inttypes.h>
+#include "context.h"
+#include "region.h"
+#include "../fake_lib/fake_os.h"
+
+//================| SwapChain Class Declaration |================//
+
+//An optional way of getting frames on screen that never draws into the
+//framebuffer being shown. The screen context always points at the back
+//buffer of a fake_os swap chain, and presenting flips to it and then picks
+//up the next back buffer. That one is some number of frames behind (its
+//age): it's missing the damage of the frames it sat out, which becomes the
+//context's stale region. Painting takes anything it covers in full out of
+//that region, drawing that only covers some pixels or reads them first
+//catches them up from the screen, and whatever's left gets copied over just
+//before the next flip. So the areas that get repainted anyway are never
+//copied, and everything else can go on drawing just what changed, the same
+//as with a single framebuffer
+
+//No buffer is ever further behind than this many frames
+#define SWAPCHAIN_HISTORY (FO_MAX_SWAP_BUFFERS - 1)
+
+typedef struct SwapChain_struct {
+    Context* context; //The screen context
+    Pixel* front; //The buffer on screen, null until the first flip
+    Rect history[SWAPCHAIN_HISTORY][CONTEXT_MAX_DAMAGE]; //Damage of the latest frames, newest first
+    int history_counts[SWAPCHAIN_HISTORY];
+    Region* stale_region; //What the back buffer is missing, worked out at each flip
+} SwapChain;
+
+//Methods
+SwapChain* SwapChain_new(Context* context, int buffer_count);
+void SwapChain_delete(SwapChain* swap_chain);
+void SwapChain_present(SwapChain* swap_chain);
+
+#endif //SWAPCHAIN_H
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "textbox.h"
 
 TextBox* TextBox_new(int x, int y, int width, int height) {
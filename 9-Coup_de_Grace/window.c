@@ -1,6 +1,7 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include "window.h"
+#include "compositor.h"
 
 
 //================| Window Class Implementation |================//
@@ -36,11 +37,42 @@ Window* Window_new(int16_t x, int16_t y, uint16_t width,
 int Window_init(Window* window, int16_t x, int16_t y, uint16_t width,
                 uint16_t height, uint16_t flags, Context* context) {
 
-    //Moved over here from the desktop 
-    //Create child list or clean up and fail
-    if(!(window->children = List_new()))
+    //Create the cached clipping regions or clean up and fail
+    if(!(window->visible_region = Region_new()))
         return 0;
 
+    if(!(window->client_region = Region_new())) {
+
+        Region_delete(window->visible_region);
+        return 0;
+    }
+
+    if(!(window->paint_region = Region_new())) {
+
+        Region_delete(window->client_region);
+        Region_delete(window->visible_region);
+        return 0;
+    }
+
+    //And the recording of what we draw
+    if(!(window->display_list = DisplayList_new())) {
+
+        Region_delete(window->paint_region);
+        Region_delete(window->client_region);
+        Region_delete(window->visible_region);
+        return 0;
+    }
+
+    //And the index used to look up our children by position
+    if(!(window->child_grid = SpatialGrid_new(width, height))) {
+
+        DisplayList_delete(window->display_list);
+        Region_delete(window->paint_region);
+        Region_delete(window->client_region);
+        Region_delete(window->visible_region);
+        return 0;
+    }
+
     //Assign the property values
     window->x = x;
     window->y = y;
@@ -49,6 +81,11 @@ int Window_init(Window* window, int16_t x, int16_t y, uint16_t width,
     window->context = context;
     window->flags = flags;
     window->parent = (Window*)0;
+    window->position_generation = 0;
+    window->first_child = (Window*)0;
+    window->last_child = (Window*)0;
+    window->prev_sibling = (Window*)0;
+    window->next_sibling = (Window*)0;
     window->drag_child = (Window*)0;
     window->drag_off_x = 0;
     window->drag_off_y = 0;
@@ -56,27 +93,68 @@ int Window_init(Window* window, int16_t x, int16_t y, uint16_t width,
     window->paint_function = Window_paint_handler;
     window->mousedown_function = Window_mousedown_handler;
     window->active_child = (Window*)0;
+    window->hit_child = (Window*)0;
+    window->grid_entry.in_grid = 0;
     window->title = (char*)0;
+    window->clip_valid = 0;
+    window->paint_calls = 0;
+    window->drawn = 0;
+    window->backing = (Context*)0;
+    window->exposed_region = (Region*)0;
+    window->backing_valid = 0;
+    window->retain_children = 0;
   
     return 1;
 }
 
-//Recursively get the absolute on-screen x-coordinate of this window
+//Bumped whenever any window moves or changes parents, which is what makes
+//the screen positions windows have cached go stale
+uint32_t window_position_generation = 1;
+
+//Note that some window's position in the tree has changed
+void Window_position_changed(void) {
+
+    window_position_generation++;
+}
+
+//Windows remember where they are on the screen, and only work it out again
+//(from their parent's remembered position) if something has moved since.
+//Inside of a backing store, 'the screen' is the backing store
+void Window_update_screen_position(Window* window) {
+
+    if(window->position_generation == window_position_generation)
+        return;
+
+    window->screen_x = window->x;
+    window->screen_y = window->y;
+
+    //A window with a backing store is the origin of everything drawn into it
+    if(window->backing) {
+
+        window->screen_x = 0;
+        window->screen_y = 0;
+    } else if(window->parent) {
+
+        Window_update_screen_position(window->parent);
+        window->screen_x += window->parent->screen_x;
+        window->screen_y += window->parent->screen_y;
+    }
+
+    window->position_generation = window_position_generation;
+}
+
 int Window_screen_x(Window* window) {
 
-    if(window->parent)
-        return window->x + Window_screen_x(window->parent);
-    
-    return window->x;
+    Window_update_screen_position(window);
+
+    return window->screen_x;
 }
 
-//Recursively get the absolute on-screen y-coordinate of this window
 int Window_screen_y(Window* window) {
 
-    if(window->parent)
-        return window->y + Window_screen_y(window->parent);
-    
-    return window->y;
+    Window_update_screen_position(window);
+
+    return window->screen_y;
 }
 
 void Window_draw_border(Window* window) {
@@ -84,6 +162,9 @@ void Window_draw_border(Window* window) {
     int screen_x = Window_screen_x(window);
     int screen_y = Window_screen_y(window);
 
+    //All of the border's lines and fills get clipped in one batch
+    Context_begin_batch(window->context);
+
     //Draw a 3px border around the window 
     Context_draw_rect(window->context, screen_x, screen_y,
                       window->width, window->height, WIN_BORDERCOLOR);
@@ -106,110 +187,324 @@ void Window_draw_border(Window* window) {
                       window->parent->active_child == window ? 
                           WIN_TITLECOLOR : WIN_TITLECOLOR_INACTIVE);
 
+    Context_end_batch(window->context);
+
     //Draw the window title
     Context_draw_text(window->context, window->title, screen_x + 10, screen_y + 10,
                       window->parent->active_child == window ? 
                           WIN_TEXTCOLOR : WIN_TEXTCOLOR_INACTIVE);
 }
 
-//Apply clipping for window bounds without subtracting child window rects
-void Window_apply_bound_clipping(Window* window, int in_recursion, List* dirty_regions) {
+//The part of the window that can be seen in its parent's context, as of
+//the last time its clipping was brought up to date. That's its visible
+//region, unless it's drawn into a backing store of its own
+Region* Window_exposed_region(Window* window) {
 
-    Rect *temp_rect, *current_dirty_rect, *clone_dirty_rect;
-    int screen_x, screen_y, i;
-    List* clip_windows;
-    Window* clipping_window;
+    return window->backing ? window->exposed_region : window->visible_region;
+}
 
-    //Can't do this without a context
-    if(!window->context)
+//Bring the window's cached clipping regions up to date. The visible region
+//is our bounds, limited to what our parent's children can be seen in, minus
+//any siblings that are on top of us. The client region trims that down to
+//the inside of our decorations, and the paint region further removes our
+//own children, leaving just the pixels that our paint handler owns.
+//A window with a backing store gets all of itself drawn there, so its
+//visible region is simply its whole backing store, and the part of it that
+//can be seen in its parent goes in its exposed region instead
+void Window_update_clip_regions(Window* window) {
+
+    Rect temp_rect;
+    int screen_x, screen_y, parent_x, parent_y, i, ok;
+    Region* outer_region;
+    Window* sibling;
+    List* above;
+
+    if(window->clip_valid)
         return;
 
-    //Build the visibility rectangle for this window
-    //If the window is decorated and we're recursing, we want to limit
-    //the window's drawable area to the area inside the window decoration.
-    //If we're not recursing, however, it means we're about to paint 
-    //ourself and therefore we want to wait until we've finished painting
-    //the window border to shrink the clipping area 
     screen_x = Window_screen_x(window);
     screen_y = Window_screen_y(window);
-    
-    if((!(window->flags & WIN_NODECORATION)) && in_recursion) {
+    parent_x = window->parent ? Window_screen_x(window->parent) : 0;
+    parent_y = window->parent ? Window_screen_y(window->parent) : 0;
+    outer_region = Window_exposed_region(window);
 
-        //Limit client drawable area 
-        screen_x += WIN_BORDERWIDTH;
-        screen_y += WIN_TITLEHEIGHT;
-        temp_rect = Rect_new(screen_y, screen_x,
-                             screen_y + window->height - WIN_TITLEHEIGHT - WIN_BORDERWIDTH - 1, 
-                             screen_x + window->width - (2*WIN_BORDERWIDTH) - 1);
-    } else {
+    temp_rect.top = parent_y + window->y;
+    temp_rect.left = parent_x + window->x;
+    temp_rect.bottom = temp_rect.top + window->height - 1;
+    temp_rect.right = temp_rect.left + window->width - 1;
+    ok = Region_set_rect(outer_region, &temp_rect);
 
-        temp_rect = Rect_new(screen_y, screen_x, screen_y + window->height - 1, 
-                             screen_x + window->width - 1);
-    }
-
-    //If there's no parent (meaning we're at the top of the window tree)
-    //then we just add our rectangle and exit
-    //Here's our change: If we were passed a dirty region list, we first
-    //clone those dirty rects into the clipping region and then intersect
-    //the top-level window bounds against it so that we're limited to the
-    //dirty region from the outset
-    if(!window->parent) {
-
-        if(dirty_regions) {
-
-            //Clone the dirty regions and put them into the clipping list
-            for(i = 0; i < dirty_regions->count; i++) {
-            
-                //Clone
-                current_dirty_rect = (Rect*)List_get_at(dirty_regions, i);
-                clone_dirty_rect = Rect_new(current_dirty_rect->top,
-                                            current_dirty_rect->left,
-                                            current_dirty_rect->bottom,
-                                            current_dirty_rect->right);
-                
-                //Add
-                Context_add_clip_rect(window->context, clone_dirty_rect);
-            }
+    //If there's a parent, we first reduce our area to the area its
+    //children can be seen in, then subtract any siblings occluding us
+    if(window->parent) {
 
-            //Finally, intersect this top level window against them
-            Context_intersect_clip_rect(window->context, temp_rect);
+        Window_update_clip_regions(window->parent);
+        ok = ok && Region_intersect(outer_region, outer_region, window->parent->client_region);
 
-        } else {
+        //Only the siblings above us that we overlap can hide any of us
+        above = Window_get_windows_above(window->parent, window);
+        ok = ok && above;
+
+        for(i = 0; ok && i < above->count; i++) {
+
+            sibling = (Window*)List_get_at(above, i);
 
-            Context_add_clip_rect(window->context, temp_rect);
+            temp_rect.top = parent_y + sibling->y;
+            temp_rect.left = parent_x + sibling->x;
+            temp_rect.bottom = temp_rect.top + sibling->height - 1;
+            temp_rect.right = temp_rect.left + sibling->width - 1;
+            ok = Context_subtract_region_rect(window->context, outer_region, &temp_rect);
         }
 
+        if(above)
+            List_delete(above);
+    }
+
+    if(window->backing) {
+
+        temp_rect.top = 0;
+        temp_rect.left = 0;
+        temp_rect.bottom = window->height - 1;
+        temp_rect.right = window->width - 1;
+        ok = ok && Region_set_rect(window->visible_region, &temp_rect);
+    }
+
+    //Limit client drawable area 
+    ok = ok && Region_copy(window->client_region, window->visible_region);
+
+    if(!(window->flags & WIN_NODECORATION)) {
+
+        temp_rect.top = screen_y + WIN_TITLEHEIGHT;
+        temp_rect.left = screen_x + WIN_BORDERWIDTH;
+        temp_rect.bottom = screen_y + window->height - WIN_BORDERWIDTH - 1;
+        temp_rect.right = screen_x + window->width - WIN_BORDERWIDTH - 1;
+        ok = ok && Region_intersect_rect(window->client_region, &temp_rect);
+    }
+
+    //Then subtract the screen rectangles of any children 
+    ok = ok && Region_copy(window->paint_region, window->client_region);
+
+    for(sibling = window->first_child; sibling; sibling = sibling->next_sibling) {
+
+        temp_rect.top = screen_y + sibling->y;
+        temp_rect.left = screen_x + sibling->x;
+        temp_rect.bottom = temp_rect.top + sibling->height - 1;
+        temp_rect.right = temp_rect.left + sibling->width - 1;
+        ok = ok && Context_subtract_region_rect(window->context, window->paint_region, &temp_rect);
+    }
+
+    //If we ran out of memory somewhere, try again next time
+    window->clip_valid = ok;
+}
+
+//Make sure the window's paint handler output is recorded in its display
+//list, calling the handler to record it if it's been invalidated
+//Returns zero if it couldn't be recorded, in which case the handler needs
+//to be called directly
+int Window_record_display_list(Window* window) {
+
+    Context* context;
+
+    if(window->display_list->valid)
+        return 1;
+
+    context = Context_for_thread(window->context);
+    DisplayList_clear(window->display_list);
+    context->recording = window->display_list;
+    window->paint_function(window);
+    window->paint_calls++;
+    context->stats.paint_calls++;
+    context->recording = (DisplayList*)0;
+    window->display_list->valid = !window->display_list->failed;
+
+    return window->display_list->valid;
+}
+
+//Draw the window and everything in it into its backing store, if that
+//hasn't been done yet. After that, anything in it that changes draws
+//itself into the backing store as it goes, so it never goes stale
+void Window_update_backing(Window* window) {
+
+    Window* child;
+
+    if(window->backing_valid)
         return;
+
+    Window_paint(window, (Region*)0, 0);
+
+    for(child = window->first_child; child; child = child->next_sibling)
+        Window_paint(child, (Region*)0, 1);
+
+    window->backing_valid = 1;
+}
+
+//Bring the cached clipping and display lists of the window and everything
+//inside of it up to date. Returns zero if any of it couldn't be worked out
+int Window_prepare_paint(Window* window) {
+
+    Window* child;
+
+    Window_update_screen_position(window);
+    Window_update_clip_regions(window);
+
+    if(!window->clip_valid)
+        return 0;
+
+    //Anything with a backing store only ever gets copied out of it, so
+    //that's all that has to be ready
+    if(window->backing) {
+
+        Window_update_backing(window);
+        return 1;
     }
 
-    //Otherwise, we first reduce our clipping area to the visibility area of our parent
-    Window_apply_bound_clipping(window->parent, 1, dirty_regions);
+    if(!Window_record_display_list(window))
+        return 0;
 
-    //Now that we've reduced our clipping area to our parent's clipping area, we can
-    //intersect our own bounds rectangle to get our main visible area  
-    Context_intersect_clip_rect(window->context, temp_rect);
+    for(child = window->first_child; child; child = child->next_sibling)
+        if(!Window_prepare_paint(child))
+            return 0;
 
-    //And finally, we subtract the rectangles of any siblings that are occluding us 
-    clip_windows = Window_get_windows_above(window->parent, window);
+    return 1;
+}
 
-    while(clip_windows->count) {
-        
-        clipping_window = (Window*)List_remove_at(clip_windows, 0);
+//Throw away the cached clipping regions of this window and of everything
+//inside of it, since those are all in screen space
+void Window_invalidate_clip(Window* window) {
 
-        //Get a rectangle from the window, subtract it from the clipping 
-        //region, and dispose of it
-        screen_x = Window_screen_x(clipping_window);
-        screen_y = Window_screen_y(clipping_window);
+    Window* child;
 
-        temp_rect = Rect_new(screen_y, screen_x,
-                             screen_y + clipping_window->height - 1,
-                             screen_x + clipping_window->width - 1);
-        Context_subtract_clip_rect(window->context, temp_rect);
-        free(temp_rect);
+    window->clip_valid = 0;
+
+    //Except that inside of a backing store, everything is positioned
+    //relative to the backing store, so nothing outside of it matters
+    if(window->backing)
+        return;
+
+    for(child = window->first_child; child; child = child->next_sibling)
+        Window_invalidate_clip(child);
+}
+
+//Throw away the cached clipping of any children of the window touching
+//the passed rect (in the window's own coordinates), which is the area
+//some sibling of theirs just appeared in, disappeared from or moved above
+//or below them in. If the children themselves moved around, the parent's
+//own paint region needs redoing too, which is up to the caller
+void Window_invalidate_clip_overlapping(Window* window, Rect* rect) {
+
+    int i, count;
+    SpatialGridEntry** overlapping;
+    Window* child;
+
+    //The grid can find just the children touching the rect, but it needs
+    //some scratch memory to hand them back in
+    if(window->context &&
+       (overlapping = SpatialGrid_query(window->child_grid, rect, 0, UINT32_MAX,
+                                        window->context->frame_arena, &count))) {
+
+        for(i = 0; i < count; i++)
+            Window_invalidate_clip((Window*)overlapping[i]->item);
+
+        return;
     }
 
-    //Dispose of the used-up list 
-    free(clip_windows);
+    for(child = window->first_child; child; child = child->next_sibling) {
+
+        if(child->x <= rect->right && (child->x + child->width - 1) >= rect->left &&
+           child->y <= rect->bottom && (child->y + child->height - 1) >= rect->top)
+            Window_invalidate_clip(child);
+    }
+}
+
+//Invalidate the clipping of any siblings of the window that it overlaps
+void Window_invalidate_clip_siblings(Window* window) {
+
+    Rect window_rect;
+
+    if(!window->parent)
+        return;
+
+    window_rect.top = window->y;
+    window_rect.left = window->x;
+    window_rect.bottom = window->y + window->height - 1;
+    window_rect.right = window->x + window->width - 1;
+    Window_invalidate_clip_overlapping(window->parent, &window_rect);
+}
+
+//Apply clipping for window bounds without subtracting child window rects
+//The region comes from the cache, so this is just a copy unless something
+//moved since we were last painted
+void Window_apply_bound_clipping(Window* window, Region* dirty_region) {
+
+    //Can't do this without a context
+    if(!window->context)
+        return;
+
+    //Limited to the dirty region if we were passed one
+    Window_update_clip_regions(window);
+    Context_set_clip_region(window->context, window->visible_region, dirty_region);
+}
+
+//Everything a window draws lands inside of its clipping region, so that's
+//the area that will need to be presented once we're done
+void Window_add_clip_damage(Window* window) {
+
+    int i;
+    Context* context = Context_for_thread(window->context);
+
+    for(i = 0; i < context->clip_region->count; i++)
+        Context_add_damage(context, &context->clip_region->rects[i]);
+}
+
+//With a swap chain, let the screen know that the window's visible area
+//(limited to the dirty region, if there is one) is about to be painted over
+//in full, children and all, so it doesn't need catching up
+void Window_mark_current(Window* window, Region* dirty_region) {
+
+    Context* context = Context_for_thread(window->context);
+
+    if(!context->stale_region || !context->stale_region->count)
+        return;
+
+    Window_update_clip_regions(window);
+    Context_set_clip_region(context, window->visible_region, dirty_region);
+    Context_mark_current(context, context->clip_region);
+    Context_clear_clip_rects(context);
+}
+
+//Same as above, but for just the part of the current clip region the
+//border is about to cover
+void Window_mark_border_current(Window* window) {
+
+    int screen_x, screen_y;
+    Rect inner_rect;
+    Region* border_region;
+    Context* context = Context_for_thread(window->context);
+
+    if(!context->stale_region || !context->stale_region->count ||
+       (window->flags & WIN_NODECORATION))
+        return;
+
+    screen_x = Window_screen_x(window);
+    screen_y = Window_screen_y(window);
+    inner_rect.top = screen_y + WIN_TITLEHEIGHT;
+    inner_rect.left = screen_x + WIN_BORDERWIDTH;
+    inner_rect.bottom = screen_y + window->height - WIN_BORDERWIDTH - 1;
+    inner_rect.right = screen_x + window->width - WIN_BORDERWIDTH - 1;
+
+    if(!(border_region = Region_new_in(context->frame_arena))) {
+
+        Context_catch_up_all(context);
+        return;
+    }
+
+    if(Region_copy(border_region, context->clip_region) &&
+       Region_subtract_rect(border_region, &inner_rect))
+        Context_mark_current(context, border_region);
+    else
+        Context_catch_up_all(context);
+
+    Region_delete(border_region);
 }
 
 void Window_update_title(Window* window) {
@@ -223,7 +518,9 @@ void Window_update_title(Window* window) {
         return;
 
     //Start by limiting painting to the window's visible area
-    Window_apply_bound_clipping(window, 0, (List*)0);
+    Window_apply_bound_clipping(window, (Region*)0);
+    Window_add_clip_damage(window);
+    Window_mark_border_current(window);
 
     //Draw border
     Window_draw_border(window);
@@ -234,8 +531,8 @@ void Window_update_title(Window* window) {
 //Request a repaint of a certain region of a window
 void Window_invalidate(Window* window, int top, int left, int bottom, int right) {
 
-    List* dirty_regions;
-    Rect* dirty_rect;
+    Region* dirty_region;
+    Rect dirty_rect;
 
     //This function takes coordinates in terms of window coordinates
     //So we need to convert them to screen space 
@@ -246,94 +543,203 @@ void Window_invalidate(Window* window, int top, int left, int bottom, int right)
     left += origin_x;
     right += origin_x;
     
-    //Attempt to create a new dirty rect list 
-    if(!(dirty_regions = List_new()))
+    //Whatever the window had drawn before is out of date now
+    DisplayList_clear(window->display_list);
+
+    //Nothing to repaint if we aren't on a screen yet
+    if(!window->context)
         return;
 
-    if(!(dirty_rect = Rect_new(top, left, bottom, right))) {
+    //Attempt to create a new dirty region 
+    if(!(dirty_region = Region_new_in(window->context->frame_arena)))
+        return;
 
-        free(dirty_regions);
+    dirty_rect.top = top;
+    dirty_rect.left = left;
+    dirty_rect.bottom = bottom;
+    dirty_rect.right = right;
+
+    if(!Region_set_rect(dirty_region, &dirty_rect)) {
+
+        Region_delete(dirty_region);
         return;
     }
 
-    if(!List_add(dirty_regions, dirty_rect)) {
+    Window_paint(window, dirty_region, 0);
+
+    //Clean up the dirty region
+    Region_delete(dirty_region);
+}
+
+//Note that the window and everything in it have been painted in full
+void Window_mark_drawn(Window* window) {
+
+    Window* child;
+
+    window->drawn = 1;
+
+    for(child = window->first_child; child; child = child->next_sibling)
+        Window_mark_drawn(child);
+}
+
+//Whether the window and everything in it have been painted in full, in
+//which case what's on screen where they're visible is exactly what painting
+//them would draw there
+int Window_is_drawn(Window* window) {
 
-        free(dirty_regions);
-        free(dirty_rect);
+    Window* child;
+
+    if(!window->drawn)
+        return 0;
+
+    for(child = window->first_child; child; child = child->next_sibling)
+        if(!Window_is_drawn(child))
+            return 0;
+
+    return 1;
+}
+
+//Add the area about to be painted to the context's paint log: all of the
+//dirty region if there is one, otherwise the whole window
+void Window_log_paint(Window* window, Region* dirty_region) {
+
+    Rect window_rect;
+    Region* paint_log = window->context->paint_log;
+
+    if(dirty_region) {
+
+        Region_union(paint_log, paint_log, dirty_region);
         return;
     }
 
-    Window_paint(window, dirty_regions, 0);
+    window_rect.top = Window_screen_y(window);
+    window_rect.left = Window_screen_x(window);
+    window_rect.bottom = window_rect.top + window->height - 1;
+    window_rect.right = window_rect.left + window->width - 1;
+    Region_union_rect(paint_log, &window_rect);
+}
+
+//Copy the window, and everything in it, out of its backing store into the
+//part of its parent's context where it can be seen, limited to the dirty
+//region (in the parent's coordinates) if there is one
+void Window_composite(Window* window, Region* dirty_region) {
+
+    int i;
+    Context* context = Context_for_thread(window->parent->context);
+
+    Window_update_backing(window);
+    Window_update_clip_regions(window);
+    Context_set_clip_region(context, window->exposed_region, dirty_region);
+    Context_mark_current(context, context->clip_region);
+
+    for(i = 0; i < context->clip_region->count; i++)
+        Context_add_damage(context, &context->clip_region->rects[i]);
 
-    //Clean up the dirty rect list
-    List_remove_at(dirty_regions, 0);
-    free(dirty_regions);
-    free(dirty_rect); 
+    Context_blit(context, window->backing, Window_screen_x(window->parent) + window->x,
+                 Window_screen_y(window->parent) + window->y);
+    Context_clear_clip_rects(context);
 }
 
 //Another override-redirect function
-void Window_paint(Window* window, List* dirty_regions, uint8_t paint_children) {
+void Window_paint(Window* window, Region* dirty_region, uint8_t paint_children) {
 
-    int i, j, screen_x, screen_y, child_screen_x, child_screen_y;
+    int screen_x, screen_y;
     Window* current_child;
-    Rect* temp_rect;
+    Rect temp_rect;
+    Context* context;
 
     //Can't paint without a context
     if(!window->context)
         return;
 
+    //Note down what we were asked to paint for the debug view, if it's on
+    //(compositor threads never log, since they're painting parts of a
+    //window that was already logged)
+    if(Context_for_thread(window->context)->paint_log)
+        Window_log_paint(window, dirty_region);
+
+    //A window with a backing store already has itself and everything in it
+    //drawn there, so painting all of that just means copying it out
+    if(paint_children && window->backing) {
+
+        Window_composite(window, dirty_region);
+        return;
+    }
+
+    //Big repaints get split up across threads if we've been given some
+    if(paint_children && window->context->compositor &&
+       Compositor_paint(window->context->compositor, window, dirty_region)) {
+
+        if(!dirty_region)
+            Window_mark_drawn(window);
+
+        return;
+    }
+
     //Start by limiting painting to the window's visible area
-    Window_apply_bound_clipping(window, 0, dirty_regions);
+    Window_apply_bound_clipping(window, dirty_region);
+    Window_add_clip_damage(window);
+
+    //All of that gets painted over, unless the children are being left
+    //alone, in which case it's just the border and then the paint region
+    context = Context_for_thread(window->context);
+
+    if(paint_children)
+        Context_mark_current(context, context->clip_region);
+    else
+        Window_mark_border_current(window);
 
     //Set the context translation
     screen_x = Window_screen_x(window);
     screen_y = Window_screen_y(window);
 
-    //If we have window decorations turned on, draw them and then further
-    //limit the clipping area to the inner drawable area of the window 
+    //If we have window decorations turned on, draw them and then move
+    //our origin to the inner drawable area of the window 
     if(!(window->flags & WIN_NODECORATION)) {
 
         //Draw border
         Window_draw_border(window);
 
-        //Limit client drawable area 
         screen_x += WIN_BORDERWIDTH;
         screen_y += WIN_TITLEHEIGHT;
-        temp_rect = Rect_new(screen_y, screen_x,
-                             screen_y + window->height - WIN_TITLEHEIGHT - WIN_BORDERWIDTH - 1, 
-                             screen_x + window->width - (2*WIN_BORDERWIDTH) - 1);
-        Context_intersect_clip_rect(window->context, temp_rect);
     }
 
-    //Then subtract the screen rectangles of any children 
-    //NOTE: We don't do this in Window_apply_bound_clipping because, due to 
-    //its recursive nature, it would cause the screen rectangles of all of 
-    //our parent's children to be subtracted from the clipping area -- which
-    //would eliminate this window. 
-    for(i = 0; i < window->children->count; i++) {
+    //Then limit the clipping area to the part of the inner drawable area
+    //not covered by any of our children (already worked out for us in
+    //the paint region), plus whatever is dirty
+    Context_set_clip_region(window->context, window->paint_region, dirty_region);
 
-        current_child = (Window*)List_get_at(window->children, i);
+    if(!paint_children)
+        Context_mark_current(context, context->clip_region);
 
-        child_screen_x = Window_screen_x(current_child);
-        child_screen_y = Window_screen_y(current_child);
+    //Finally, with all the clipping set up, we can set the context's 0,0 to the top-left corner
+    //of the window's drawable area, and call the window's final paint function 
+    context->translate_x = screen_x;
+    context->translate_y = screen_y;
+
+    //Rather than calling back into the paint handler every time, we play
+    //back what it drew the last time we did
+    //(The count can be a little off if tiles end up calling the handler at
+    //the same time, but that only happens if recording ran out of memory)
+    if(Window_record_display_list(window)) {
+
+        DisplayList_replay(window->display_list, window->context);
+    } else {
 
-        temp_rect = Rect_new(child_screen_y, child_screen_x,
-                             child_screen_y + current_child->height - 1,
-                             child_screen_x + current_child->width - 1);
-        Context_subtract_clip_rect(window->context, temp_rect);
-        free(temp_rect);
+        window->paint_function(window);
+        window->paint_calls++;
+        context->stats.paint_calls++;
     }
 
-    //Finally, with all the clipping set up, we can set the context's 0,0 to the top-left corner
-    //of the window's drawable area, and call the window's final paint function 
-    window->context->translate_x = screen_x;
-    window->context->translate_y = screen_y;
-    window->paint_function(window);
+    context->stats.windows_painted++;
 
     //Now that we're done drawing this window, we can clear the changes we made to the context
-    Context_clear_clip_rects(window->context);
-    window->context->translate_x = 0;
-    window->context->translate_y = 0;
+    Context_clear_clip_rects(context);
+    context->translate_x = 0;
+    context->translate_y = 0;
+
+    if(!dirty_region)
+        window->drawn = 1;
     
     //Even though we're no longer having all mouse events cause a redraw from the desktop
     //down, we still need to call paint on our children in the case that we were called with
@@ -342,35 +748,26 @@ void Window_paint(Window* window, List* dirty_regions, uint8_t paint_children) {
     if(!paint_children)
         return;
 
-    for(i = 0; i < window->children->count; i++) {
+    //Back to front, so that anything higher up the stack paints over
+    //anything under it
+    for(current_child = window->first_child; current_child;
+        current_child = current_child->next_sibling) {
 
-        current_child = (Window*)List_get_at(window->children, i);
+        if(dirty_region) {
 
-        if(dirty_regions) {
-
-            //Check to see if the child is affected by any of the
-            //dirty region rectangles
-            for(j = 0; j < dirty_regions->count; j++) {
-            
-                temp_rect = (Rect*)List_get_at(dirty_regions, j);
-                
-                screen_x = Window_screen_x(current_child);
-                screen_y = Window_screen_y(current_child);
-
-                if(temp_rect->left <= (screen_x + current_child->width - 1) &&
-                   temp_rect->right >= screen_x &&
-                   temp_rect->top <= (screen_y + current_child->height - 1) &&
-                   temp_rect->bottom >= screen_y)
-                    break;
-            }
+            //Check to see if the child is affected by the dirty region
+            temp_rect.top = Window_screen_y(window) + current_child->y;
+            temp_rect.left = Window_screen_x(window) + current_child->x;
+            temp_rect.bottom = temp_rect.top + current_child->height - 1;
+            temp_rect.right = temp_rect.left + current_child->width - 1;
 
             //Skip drawing this child if no intersection was found
-            if(j == dirty_regions->count)
+            if(!Region_intersects_rect(dirty_region, &temp_rect))
                 continue;
         }
 
         //Otherwise, recursively request the child to redraw its dirty areas
-        Window_paint(current_child, dirty_regions, 1);
+        Window_paint(current_child, dirty_region, 1);
     }
 }
 
@@ -382,86 +779,164 @@ void Window_paint_handler(Window* window) {
                       window->width, window->height, WIN_BGCOLOR);
 }
 
+//Get the window's rect in its parent's coordinates
+void Window_parent_rect(Window* window, Rect* rect) {
+
+    rect->top = window->y;
+    rect->left = window->x;
+    rect->bottom = window->y + window->height - 1;
+    rect->right = window->x + window->width - 1;
+}
+
+//Find the topmost child of the window under a point in the window's
+//coordinates, or null if there isn't one
+Window* Window_child_at(Window* window, int x, int y) {
+
+    Rect point_rect;
+    SpatialGridEntry* entry;
+    Window* child = window->hit_child;
+
+    //Mouse events tend to come in runs over the same child. If the point
+    //is in the part of that child that nothing else covers, which its
+    //clipping cache already knows, it's our answer without any searching
+    if(child && child->clip_valid) {
+
+        point_rect.top = point_rect.bottom = Window_screen_y(window) + y;
+        point_rect.left = point_rect.right = Window_screen_x(window) + x;
+
+        if(Region_intersects_rect(Window_exposed_region(child), &point_rect))
+            return child;
+    }
+
+    entry = SpatialGrid_topmost_at(window->child_grid, x, y);
+    window->hit_child = entry ? (Window*)entry->item : (Window*)0;
+
+    return window->hit_child;
+}
+
 //Used to get a list of windows overlapping the passed window
+//The list lives in the frame arena, so it's only good until the end of the event
 List* Window_get_windows_above(Window* parent, Window* child) {
 
-    int i;
-    Window* current_window;
+    int i, count;
+    Rect child_rect;
+    SpatialGridEntry** overlapping;
     List* return_list;
 
     //Attempt to allocate the output list
-    if(!(return_list = List_new()))
+    if(!(return_list = List_new_in(parent->context->frame_arena)))
         return return_list;
 
-    //We just need to get a list of all items in the
-    //child list at higher indexes than the passed window
-    //We start by finding the passed child in the list
-    for(i = 0; i < parent->children->count; i++)
-        if(child == (Window*)List_get_at(parent->children, i))
-            break;
+    //Nothing is above or below a window that isn't in the stack
+    if(!child->grid_entry.in_grid)
+        return return_list;
 
-    //Now we just need to add the remaining items in the list
-    //to the output (IF they overlap, of course)
-    //NOTE: As a bonus, this will also automatically fall through
-    //if the window wasn't found
-    for(i++; i < parent->children->count; i++) {
+    //The grid only has to look at the cells we cover, and hands back
+    //what it finds in stacking order
+    Window_parent_rect(child, &child_rect);
 
-        current_window = List_get_at(parent->children, i);
+    if(!(overlapping = SpatialGrid_query(parent->child_grid, &child_rect, child->grid_entry.z + 1,
+                                         UINT32_MAX, parent->context->frame_arena, &count))) {
 
-        //Our good old rectangle intersection logic
-        if(current_window->x <= (child->x + child->width - 1) &&
-		   (current_window->x + current_window->width - 1) >= child->x &&
-		   current_window->y <= (child->y + child->height - 1) &&
-		   (current_window->y + current_window->height - 1) >= child->y)
-            List_add(return_list, current_window); //Insert the overlapping window
+        List_delete(return_list);
+        return (List*)0;
     }
 
+    for(i = 0; i < count; i++)
+        List_add(return_list, overlapping[i]->item);
+
     return return_list; 
 }
 
 //Used to get a list of windows which the passed window overlaps
-//Same exact thing as get_windows_above, but goes backwards through
-//the list. Could probably be made a little less redundant if you really wanted
+//(also a frame arena list)
+//Same exact thing as get_windows_above, but looks lower in the stack and
+//goes from the top down
 List* Window_get_windows_below(Window* parent, Window* child) {
 
-    int i;
-    Window* current_window;
+    int i, count;
+    Rect child_rect;
+    SpatialGridEntry** overlapping;
     List* return_list;
 
     //Attempt to allocate the output list
-    if(!(return_list = List_new()))
+    if(!(return_list = List_new_in(parent->context->frame_arena)))
         return return_list;
 
-    //We just need to get a list of all items in the
-    //child list at higher indexes than the passed window
-    //We start by finding the passed child in the list
-    for(i = parent->children->count - 1; i > -1; i--)
-        if(child == (Window*)List_get_at(parent->children, i))
-            break;
+    if(!child->grid_entry.in_grid || !child->grid_entry.z)
+        return return_list;
 
-    //Now we just need to add the remaining items in the list
-    //to the output (IF they overlap, of course)
-    //NOTE: As a bonus, this will also automatically fall through
-    //if the window wasn't found
-    for(i--; i > -1; i--) {
+    Window_parent_rect(child, &child_rect);
 
-        current_window = List_get_at(parent->children, i);
+    if(!(overlapping = SpatialGrid_query(parent->child_grid, &child_rect, 0,
+                                         child->grid_entry.z - 1, parent->context->frame_arena,
+                                         &count))) {
 
-        //Our good old rectangle intersection logic
-        if(current_window->x <= (child->x + child->width - 1) &&
-		   (current_window->x + current_window->width - 1) >= child->x &&
-		   current_window->y <= (child->y + child->height - 1) &&
-		   (current_window->y + current_window->height - 1) >= child->y)
-            List_add(return_list, current_window); //Insert the overlapping window
+        List_delete(return_list);
+        return (List*)0;
     }
 
+    for(i = count - 1; i >= 0; i--)
+        List_add(return_list, overlapping[i]->item);
+
     return return_list; 
 }
 
+//Our children are stacked in a chain running from the bottom-most
+//(first_child) to the top-most (last_child), each one linked to the
+//siblings directly below and above it. That makes taking a window out of
+//the stack or putting it back on either end a few pointer updates
+
+//Put a child at the top of the window's stack
+void Window_link_child(Window* window, Window* child) {
+
+    child->prev_sibling = window->last_child;
+    child->next_sibling = (Window*)0;
+
+    if(window->last_child)
+        window->last_child->next_sibling = child;
+    else
+        window->first_child = child;
+
+    window->last_child = child;
+}
+
+//Put a child at the bottom of the window's stack
+void Window_link_child_bottom(Window* window, Window* child) {
+
+    child->prev_sibling = (Window*)0;
+    child->next_sibling = window->first_child;
+
+    if(window->first_child)
+        window->first_child->prev_sibling = child;
+    else
+        window->last_child = child;
+
+    window->first_child = child;
+}
+
+//Take a window out of its parent's stack
+void Window_unlink_child(Window* child) {
+
+    Window* parent = child->parent;
+
+    if(child->prev_sibling)
+        child->prev_sibling->next_sibling = child->next_sibling;
+    else
+        parent->first_child = child->next_sibling;
+
+    if(child->next_sibling)
+        child->next_sibling->prev_sibling = child->prev_sibling;
+    else
+        parent->last_child = child->prev_sibling;
+
+    child->prev_sibling = (Window*)0;
+    child->next_sibling = (Window*)0;
+}
+
 //Breaking 
 void Window_raise(Window* window, uint8_t do_draw) {
 
-    int i;
     Window *parent, *last_active;
 
     if(!window->parent)
@@ -474,35 +949,111 @@ void Window_raise(Window* window, uint8_t do_draw) {
 
     last_active = parent->active_child;
 
-    //Find the child in the list
-    for(i = 0; i < parent->children->count; i++)
-        if((Window*)List_get_at(parent->children, i) == window)
-            break;
+    //Pull the window out of the stack and put it back on top
+    Window_unlink_child(window);
+    Window_link_child(parent, window);
+    SpatialGrid_raise(parent->child_grid, &window->grid_entry);
 
-    List_remove_at(parent->children, i); //Pull window out of list
-    List_add(parent->children, (void*)window); //Insert at the top
+    //Being on top changes who's hidden by who, but only where we are
+    Window_invalidate_clip_siblings(window);
   
     //Make it active 
     parent->active_child = window;
+
+    //That changes our title color, and any copy of us in a backing store
+    //needs to know that before it gets copied anywhere
+    if(window->backing)
+        Window_update_title(window);
    
     //Do a redraw if it was requested
     if(!do_draw)
         return;
 
-    Window_paint(window, (List*)0, 1);
+    Window_paint(window, (Region*)0, 1);
 
     //Make sure the old active window gets an updated title color 
     Window_update_title(last_active);
 }
 
+//Put the window at the bottom of its parent's stack, handing the focus to
+//whatever ends up on top
+void Window_lower(Window* window, uint8_t do_draw) {
+
+    Window *parent, *last_active;
+    Region* dirty_region;
+    Rect window_rect;
+
+    if(!window->parent)
+        return;
+
+    parent = window->parent;
+
+    if(parent->first_child == window)
+        return;
+
+    last_active = parent->active_child;
+
+    Window_unlink_child(window);
+    Window_link_child_bottom(parent, window);
+    SpatialGrid_lower(parent->child_grid, &window->grid_entry);
+    Window_invalidate_clip_siblings(window);
+    parent->active_child = parent->last_child;
+
+    //Without a context there's nothing to draw on
+    if(!do_draw || !window->context)
+        return;
+
+    //Whatever we were covering gets uncovered
+    if(!(dirty_region = Region_new_in(parent->context->frame_arena)))
+        return;
+
+    window_rect.top = Window_screen_y(parent) + window->y;
+    window_rect.left = Window_screen_x(parent) + window->x;
+    window_rect.bottom = window_rect.top + window->height - 1;
+    window_rect.right = window_rect.left + window->width - 1;
+
+    if(Region_set_rect(dirty_region, &window_rect))
+        Window_paint(parent, dirty_region, 1);
+
+    Region_delete(dirty_region);
+
+    //And the focus change needs to show up in the title bars
+    if(last_active && last_active != parent->active_child) {
+
+        Window_update_title(last_active);
+        Window_update_title(parent->active_child);
+    }
+}
+
 //We're wrapping this guy so that we can handle any needed redraw
 void Window_move(Window* window, int new_x, int new_y) {
 
-    int i;
     int old_x = window->x;
     int old_y = window->y;
-    Rect new_window_rect;
-    List *replacement_list, *dirty_list, *dirty_windows;
+    Rect new_window_rect, old_window_rect;
+    Region *dirty_region, *copied_region, *unpainted_region;
+    List* dirty_windows;
+    Context* context = window->parent->context;
+
+    //If we're already on screen, most of what we'll look like after the move
+    //can just be copied over from where we are now instead of painted again.
+    //That's only what's visible before we get raised, since anything that
+    //was covered hasn't been drawn yet. (With a backing store, all of us
+    //gets copied out of that instead)
+    copied_region = (Region*)0;
+
+    if((old_x != new_x || old_y != new_y) && !window->backing && Window_is_drawn(window)) {
+
+        Window_update_clip_regions(window);
+
+        if(window->clip_valid &&
+           (copied_region = Region_new_in(window->context->frame_arena)) &&
+           !Region_copy(copied_region, window->visible_region)) {
+
+            Region_delete(copied_region);
+            copied_region = (Region*)0;
+        }
+    }
 
     //To make life a little bit easier, we'll make the not-unreasonable 
     //rule that if a window is moved, it must become the top-most window
@@ -510,84 +1061,135 @@ void Window_move(Window* window, int new_x, int new_y) {
 
     //We'll hijack our dirty rect collection from our existing clipping operations
     //So, first we'll get the visible regions of the original window position
-    Window_apply_bound_clipping(window, 0, (List*)0);
+    //(all of this happens in our parent's context, which is the screen
+    //unless the parent has a backing store)
+    Window_update_clip_regions(window);
+    Context_set_clip_region(context, Window_exposed_region(window), (Region*)0);
 
-    //Temporarily update the window position
-    window->x = new_x;
-    window->y = new_y;
+    //Remember where we were, in our parent's coordinates
+    old_window_rect.top = old_y;
+    old_window_rect.left = old_x;
+    old_window_rect.bottom = old_y + window->height - 1;
+    old_window_rect.right = old_x + window->width - 1;
 
     //Calculate the new bounds
-    new_window_rect.top = Window_screen_y(window);
-    new_window_rect.left = Window_screen_x(window);
+    new_window_rect.top = Window_screen_y(window->parent) + new_y;
+    new_window_rect.left = Window_screen_x(window->parent) + new_x;
     new_window_rect.bottom = new_window_rect.top + window->height - 1;
     new_window_rect.right = new_window_rect.left + window->width - 1;
 
-    //Reset the window position
-    window->x = old_x;
-    window->y = old_y;
-
     //Now, we'll get the *actual* dirty area by subtracting the new location of
     //the window 
-    Context_subtract_clip_rect(window->context, &new_window_rect);
+    Context_subtract_clip_rect(context, &new_window_rect);
 
-    //Now that the context clipping tools made the list of dirty rects for us,
-    //we can go ahead and steal the list it made for our own purposes
-    //(yes, it would be cleaner to spin off our boolean rect functions so that
-    //they can be used both here and by the clipping region tools, but I ain't 
-    //got time for that junk)
-    if(!(replacement_list = List_new())) {
+    //Now that the context clipping tools made the dirty region for us,
+    //we can go ahead and take a copy of it for our own purposes
+    if(!(dirty_region = Region_new_in(context->frame_arena))) {
 
-        Context_clear_clip_rects(window->context);
+        Context_clear_clip_rects(context);
         return;
     }
 
-    dirty_list = window->context->clip_rects;
-    window->context->clip_rects = replacement_list;
+    if(!Region_copy(dirty_region, context->clip_region)) {
+
+        Region_delete(dirty_region);
+        Context_clear_clip_rects(context);
+        return;
+    }
+
+    Context_clear_clip_rects(context);
 
     //Now, let's get all of the siblings that we overlap before the move
-    dirty_windows = Window_get_windows_below(window->parent, window);
+    if(!(dirty_windows = Window_get_windows_below(window->parent, window))) {
+
+        Region_delete(dirty_region);
+        return;
+    }
 
     window->x = new_x;
     window->y = new_y;
+    Window_position_changed();
+    Window_parent_rect(window, &new_window_rect);
+    SpatialGrid_move(window->parent->child_grid, &window->grid_entry, &new_window_rect);
+
+    //The move changes what's hidden where we used to be and where we are
+    //now, including the part of the parent we cover. Anything inside of us
+    //moved along with us
+    window->parent->clip_valid = 0;
+    Window_invalidate_clip_overlapping(window->parent, &old_window_rect);
+    Window_invalidate_clip_siblings(window);
+    Window_invalidate_clip(window);
+
+    //Copy over whatever we had on screen that's still visible after the
+    //move. This has to happen before the siblings repaint, since they'll
+    //be painting over the spot we're copying from
+    if(copied_region) {
+
+        Region_translate(copied_region, new_x - old_x, new_y - old_y);
+        Window_update_clip_regions(window);
+
+        if(window->clip_valid &&
+           Region_intersect(copied_region, copied_region, window->visible_region)) {
+
+            Region_translate(copied_region, old_x - new_x, old_y - new_y);
+            Context_copy_region(window->context, copied_region, new_x - old_x, new_y - old_y);
+            Region_translate(copied_region, new_x - old_x, new_y - old_y);
+        } else {
 
-    //And we'll repaint all of them using the dirty rects
+            Region_delete(copied_region);
+            copied_region = (Region*)0;
+        }
+    }
+
+    //And we'll repaint all of them using the dirty region
     //(removing them from the list as we go for convenience)
     while(dirty_windows->count)
-        Window_paint((Window*)List_remove_at(dirty_windows, 0), dirty_list, 1);
+        Window_paint((Window*)List_remove_at(dirty_windows, 0), dirty_region, 1);
 
     //The one thing that might still be dirty is the parent we're inside of
-    Window_paint(window->parent, dirty_list, 0);
+    Window_paint(window->parent, dirty_region, 0);
 
-    //We're done with the lists, so we can dump them
-    while(dirty_list->count)
-        free(List_remove_at(dirty_list, 0));
-
-    free(dirty_list);
-    free(dirty_windows);
+    //We're done with the region and the list, so we can dump them
+    Region_delete(dirty_region);
+    List_delete(dirty_windows);
 
     //With the dirtied siblings redrawn, we can do the final update of 
-    //the window location and paint it at that new position
-    Window_paint(window, (List*)0, 1);
+    //the window location and paint it at that new position. If we copied
+    //most of it over, that's just whatever the copy couldn't cover
+    if(!copied_region) {
+
+        Window_paint(window, (Region*)0, 1);
+        return;
+    }
+
+    if(!(unpainted_region = Region_new_in(window->context->frame_arena)) ||
+       !Region_subtract(unpainted_region, window->visible_region, copied_region)) {
+
+        if(unpainted_region)
+            Region_delete(unpainted_region);
+
+        Region_delete(copied_region);
+        Window_paint(window, (Region*)0, 1);
+        return;
+    }
+
+    if(unpainted_region->count)
+        Window_paint(window, unpainted_region, 1);
+
+    Region_delete(unpainted_region);
+    Region_delete(copied_region);
 }
 
 //Interface between windowing system and mouse device
 void Window_process_mouse(Window* window, uint16_t mouse_x,
                           uint16_t mouse_y, uint8_t mouse_buttons) {
 
-    int i, inner_x1, inner_y1, inner_x2, inner_y2;
     Window* child;
 
     //If we had a button depressed, then we need to see if the mouse was
     //over any of the child windows
-    //We go front-to-back in terms of the window stack for free occlusion
-    for(i = window->children->count - 1; i >= 0; i--) {
-
-        child = (Window*)List_get_at(window->children, i);
-
-        //If mouse isn't window bounds, we can't possibly be interacting with it 
-        if(!(mouse_x >= child->x && mouse_x < (child->x + child->width) &&
-           mouse_y >= child->y && mouse_y < (child->y + child->height))) 
-            continue;
+    //The grid finds the frontmost one under the mouse for free occlusion
+    if((child = Window_child_at(window, mouse_x, mouse_y))) {
 
         //Now we'll check to see if we're dragging a titlebar
         if(mouse_buttons && !window->last_button_state) {
@@ -608,15 +1210,22 @@ void Window_process_mouse(Window* window, uint16_t mouse_x,
                 window->drag_off_y = mouse_y - child->y;
                 window->drag_child = child;
                 
-                //We break without setting target_child if we're doing a drag since
+                //We don't forward the event if we're doing a drag since
                 //that shouldn't trigger a mouse event in the child 
-                break;
+                child = (Window*)0;
             }
         }
+    }
+
+    //Found a target, so forward the mouse event to that window
+    //The child may not have seen the last few events (they could have
+    //gone to a sibling, or been merged away by the input queue), so
+    //bring its idea of the previous button state in line with ours
+    //first. That way it only sees a click when one really happened
+    if(child) {
 
-        //Found a target, so forward the mouse event to that window and quit looking
+        child->last_button_state = window->last_button_state;
         Window_process_mouse(child, mouse_x - child->x, mouse_y - child->y, mouse_buttons); 
-        break;
     }
 
     //Moving this outside of the mouse-in-child detection since it doesn't really
@@ -648,22 +1257,139 @@ void Window_mousedown_handler(Window* window, int x, int y) {
 
 void Window_update_context(Window* window, Context* context) {
 
-    int i;
+    Window* child;
+
+    //Anything with a backing store keeps on drawing into it
+    if(window->backing)
+        context = window->backing;
 
     window->context = context;
 
-    for(i = 0; i < window->children->count; i++)
-        Window_update_context((Window*)List_get_at(window->children, i), context);
+    for(child = window->first_child; child; child = child->next_sibling)
+        Window_update_context(child, context);
+}
+
+//Give the window a backing store of its own that it and everything in it
+//get drawn into, so that uncovering it or moving it around only ever has
+//to copy it back out instead of painting it again. This trades the memory
+//for a copy of the window's pixels for never calling its paint handlers
+//again unless it changes. Returns zero if there wasn't enough memory
+int Window_create_backing(Window* window) {
+
+    Window* child;
+
+    if(window->backing)
+        return 1;
+
+    if(!window->parent || !window->parent->context)
+        return 0;
+
+    if(!(window->exposed_region = Region_new()))
+        return 0;
+
+    if(!(window->backing = Context_new_offscreen(window->parent->context,
+                                                 window->width, window->height))) {
+
+        Region_delete(window->exposed_region);
+        window->exposed_region = (Region*)0;
+        return 0;
+    }
+
+    //Everything inside of us gets redrawn into the backing store the first
+    //time we need to be copied out of it, with all of the positions and
+    //clipping now relative to it instead of the screen
+    Window_update_context(window, window->backing);
+    window->backing_valid = 0;
+    window->clip_valid = 0;
+
+    for(child = window->first_child; child; child = child->next_sibling)
+        Window_invalidate_clip(child);
+
+    Window_position_changed();
+
+    return 1;
+}
+
+//Copy whatever has been drawn into the backing stores of the window's
+//children since the last time this was called out into the window's own
+//context. Drawing into a backing store damages it the same way drawing on
+//the screen does, so that's what needs copying
+void Window_composite_damage(Window* window) {
+
+    int i;
+    Window* child;
+    Region* dirty_region;
+    Rect dirty_rect;
+
+    for(child = window->first_child; child; child = child->next_sibling) {
+
+        if(!child->backing)
+            continue;
+
+        //Drawing into it was work done for the screen too
+        Context_merge_stats(window->context, child->backing);
+
+        if(!child->backing->damage_count)
+            continue;
+
+        if(!(dirty_region = Region_new_in(window->context->frame_arena)))
+            return;
+
+        for(i = 0; i < child->backing->damage_count; i++) {
+
+            dirty_rect = child->backing->damage_rects[i];
+            dirty_rect.top += Window_screen_y(window) + child->y;
+            dirty_rect.left += Window_screen_x(window) + child->x;
+            dirty_rect.bottom += Window_screen_y(window) + child->y;
+            dirty_rect.right += Window_screen_x(window) + child->x;
+            Region_union_rect(dirty_region, &dirty_rect);
+        }
+
+        Window_composite(child, dirty_region);
+        Context_clear_damage(child->backing);
+        Region_delete(dirty_region);
+    }
+}
+
+//Put a child on top of the window's stack of children, both in the sibling
+//chain and in the grid. Returns zero if we ran out of memory
+int Window_add_child(Window* window, Window* child) {
+
+    Rect child_rect;
+
+    Window_parent_rect(child, &child_rect);
+
+    if(!SpatialGrid_insert(window->child_grid, &child->grid_entry, (void*)child, &child_rect))
+        return 0;
+
+    Window_link_child(window, child);
+
+    return 1;
 }
 
 //Quick wrapper for shoving a new entry into the child list
 void Window_insert_child(Window* window, Window* child) {
 
     child->parent = window;
-    List_add(window->children, child);
+    Window_position_changed();
+
+    if(!Window_add_child(window, child))
+        return;
+
     child->parent->active_child = child;
     
     Window_update_context(child, window->context);
+
+    //Some windows have each of their children drawn into a backing store.
+    //Without the memory for one, the child just gets drawn directly
+    if(window->retain_children)
+        Window_create_backing(child);
+
+    //Whatever we land on top of will need to recalculate its clipping,
+    //including the parent we now cover part of
+    Window_invalidate_clip(child);
+    window->clip_valid = 0;
+    Window_invalidate_clip_siblings(child);
 }
 
 //A method to automatically create a new window in the provided parent window
@@ -677,7 +1403,7 @@ Window* Window_create_window(Window* window, int16_t x, int16_t y,
 
     //Attempt to add the window to the end of the parent's children list
     //If we fail, make sure to clean up all of our allocations so far 
-    if(!List_add(window->children, (void*)new_window)) {
+    if(!Window_add_child(window, new_window)) {
 
         free(new_window);
         return (Window*)0;
@@ -685,8 +1411,15 @@ Window* Window_create_window(Window* window, int16_t x, int16_t y,
 
     //Set the new child's parent 
     new_window->parent = window;
+    Window_position_changed();
     new_window->parent->active_child = new_window;
 
+    if(window->retain_children)
+        Window_create_backing(new_window);
+
+    window->clip_valid = 0;
+    Window_invalidate_clip_siblings(new_window);
+
     return new_window;
 }
 
@@ -2,6 +2,8 @@
 #define WINDOW_H 
 
 #include "context.h"
+#include "displaylist.h"
+#include "spatialgrid.h"
 #include <inttypes.h>
 
 //================| Window Class Declaration |================//
@@ -36,13 +38,33 @@ typedef struct Window_struct {
     Context* context;
     struct Window_struct* drag_child;
     struct Window_struct* active_child;
-    List* children;
+    struct Window_struct* first_child; //The bottom of our stack of children
+    struct Window_struct* last_child; //And the top of it
+    struct Window_struct* prev_sibling; //The sibling just below us in our parent's stack
+    struct Window_struct* next_sibling; //And the one just above us
     uint16_t drag_off_x;
     uint16_t drag_off_y;
     uint8_t last_button_state;
     WindowPaintHandler paint_function;
     WindowMousedownHandler mousedown_function;
     char* title;
+    Region* visible_region; //Cached screen areas not hidden by anything else
+    Region* client_region; //The part of visible_region our children can be seen in
+    Region* paint_region; //The part of client_region not covered by our children
+    uint8_t clip_valid; //Zero when the cached regions need to be rebuilt
+    DisplayList* display_list; //What paint_function drew last time it was called
+    SpatialGrid* child_grid; //Finds our children by position
+    SpatialGridEntry grid_entry; //Our place in our parent's child_grid
+    struct Window_struct* hit_child; //The child the last mouse event landed in
+    int screen_x; //Where we are on the screen, as of position_generation
+    int screen_y;
+    uint32_t position_generation;
+    unsigned long paint_calls; //How many times paint_function has been called
+    uint8_t drawn; //Set once we've been painted in full, so our pixels on screen are current
+    Context* backing; //If set, we and everything in us get drawn here instead of into our parent's context
+    Region* exposed_region; //With a backing store, the part of us that can be seen in our parent's context
+    uint8_t backing_valid; //Set once everything has been drawn into the backing store
+    uint8_t retain_children; //Give each child added to us a backing store of its own
 } Window;
 
 //Methods
@@ -52,7 +74,7 @@ int Window_init(Window* window, int16_t x, int16_t y, uint16_t width,
                 uint16_t height, uint16_t flags, Context* context);
 int Window_screen_x(Window* window);
 int Window_screen_y(Window* window);                   
-void Window_paint(Window* window, List* dirty_regions, uint8_t paint_children);
+void Window_paint(Window* window, Region* dirty_region, uint8_t paint_children);
 void Window_process_mouse(Window* window, uint16_t mouse_x,
                           uint16_t mouse_y, uint8_t mouse_buttons);
 void Window_paint_handler(Window* window);
@@ -60,11 +82,17 @@ void Window_mousedown_handler(Window* window, int x, int y);
 List* Window_get_windows_above(Window* parent, Window* child);
 List* Window_get_windows_below(Window* parent, Window* child);
 void Window_raise(Window* window, uint8_t do_draw);
+void Window_lower(Window* window, uint8_t do_draw);
 void Window_move(Window* window, int new_x, int new_y);
 Window* Window_create_window(Window* window, int16_t x, int16_t y,  
                              uint16_t width, int16_t height, uint16_t flags);
 void Window_insert_child(Window* window, Window* child);   
 void Window_invalidate(Window* window, int top, int left, int bottom, int right); 
+void Window_invalidate_clip(Window* window);
+int Window_create_backing(Window* window);
+void Window_composite_damage(Window* window);
+int Window_prepare_paint(Window* window);
+void Window_mark_current(Window* window, Region* dirty_region);
 void Window_set_title(Window* window, char* new_title);                       
 void Window_append_title(Window* window, char* additional_chars);
 
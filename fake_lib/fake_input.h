@@ -0,0 +1,194 @@
+#ifndef FAKE_INPUT_H
+#define FAKE_INPUT_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fake_os.h"
+
+//================| Input Queue |================//
+
+//Shared by both fake_os backends. It lives entirely in this header (like the
+//font data does) so that every chapter's build script keeps working without
+//having to learn about another source file.
+//
+//Events go into a single-producer/single-consumer ring: the producer is
+//whatever reads the mouse device (DOM listeners, the native event source)
+//and the consumer is fake_os_pollMouseEvent, called from the frame handler.
+//At the start of each frame we take a snapshot of how far the producer has
+//got, and polling only hands out events from before that point. While doing
+//so it merges runs of motion events that share a button state into their
+//last event, and drops hover motion that ends in a press (the press carries
+//its own position). Button transitions are always delivered, so a frame
+//normally costs every click plus at most one motion.
+
+#define FO_INPUT_RING_SIZE 1024 //Must be a power of two
+#define FO_INPUT_BACKLOG_SIZE 64 //To begin with, it grows as needed
+
+typedef struct fo_input_event_struct {
+    uint16_t mouse_x;
+    uint16_t mouse_y;
+    uint8_t buttons;
+} fo_input_event;
+
+static fo_input_event fo_input_ring[FO_INPUT_RING_SIZE];
+static uint32_t fo_input_head = 0; //Written only by the producer
+static uint32_t fo_input_tail = 0; //Written only by the consumer
+static uint32_t fo_input_frame_end = 0; //Consumer's snapshot of the head
+static uint8_t fo_input_buttons = 0; //Button state last handed out
+
+//Producer-side holding area for button transitions that arrive while the
+//ring is full. Motion is simply dropped in that case since a newer motion
+//always supersedes it, but clicks have to wait their turn
+static fo_input_event fo_input_backlog_storage[FO_INPUT_BACKLOG_SIZE];
+static fo_input_event* fo_input_backlog = fo_input_backlog_storage;
+static int fo_input_backlog_count = 0;
+static int fo_input_backlog_capacity = FO_INPUT_BACKLOG_SIZE;
+static uint8_t fo_input_producer_buttons = 0;
+
+static int fake_input_push(fo_input_event* event) {
+
+    uint32_t head = fo_input_head;
+
+    //Compare against the tail the consumer has published
+    if(head - __atomic_load_n(&fo_input_tail, __ATOMIC_ACQUIRE) == FO_INPUT_RING_SIZE)
+        return 0;
+
+    fo_input_ring[head & (FO_INPUT_RING_SIZE - 1)] = *event;
+    __atomic_store_n(&fo_input_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+//Hold a button transition back until the ring has room for it. The backlog
+//doubles whenever it fills up. If even that fails, the newest transition
+//takes the place of the last one held back (or cancels it out if it goes
+//back to the state before it), so a click can get lost but the buttons
+//still end up in the state they're really in
+static void fake_input_hold_back(fo_input_event* event) {
+
+    fo_input_event* new_backlog;
+
+    if(fo_input_backlog_count == fo_input_backlog_capacity) {
+
+        if(fo_input_backlog == fo_input_backlog_storage) {
+
+            if((new_backlog = (fo_input_event*)malloc(sizeof(fo_input_event) * fo_input_backlog_capacity * 2)))
+                memcpy(new_backlog, fo_input_backlog, sizeof(fo_input_event) * fo_input_backlog_count);
+        } else {
+
+            new_backlog = (fo_input_event*)realloc(fo_input_backlog,
+                                                   sizeof(fo_input_event) * fo_input_backlog_capacity * 2);
+        }
+
+        if(new_backlog) {
+
+            fo_input_backlog = new_backlog;
+            fo_input_backlog_capacity *= 2;
+        } else {
+
+            fo_input_backlog_count--;
+
+            if(fo_input_backlog_count &&
+               fo_input_backlog[fo_input_backlog_count - 1].buttons == event->buttons)
+                return;
+        }
+    }
+
+    fo_input_backlog[fo_input_backlog_count++] = *event;
+}
+
+//Producer: add a raw event to the queue
+static void fake_input_enqueue(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
+    int i, j;
+    fo_input_event event;
+
+    event.mouse_x = mouse_x;
+    event.mouse_y = mouse_y;
+    event.buttons = buttons;
+
+    //Anything held back has to go in first to keep the order intact
+    for(i = 0; i < fo_input_backlog_count && fake_input_push(&fo_input_backlog[i]); i++);
+
+    if(i) {
+
+        fo_input_backlog_count -= i;
+
+        for(j = 0; j < fo_input_backlog_count; j++)
+            fo_input_backlog[j] = fo_input_backlog[i + j];
+    }
+
+    if(fo_input_backlog_count || !fake_input_push(&event)) {
+
+        if(buttons != fo_input_producer_buttons)
+            fake_input_hold_back(&event);
+    }
+
+    fo_input_producer_buttons = buttons;
+}
+
+//Consumer: mark the end of the events belonging to the current frame
+static void fake_input_begin_frame(void) {
+
+    fo_input_frame_end = __atomic_load_n(&fo_input_head, __ATOMIC_ACQUIRE);
+}
+
+//Consumer: get the next coalesced event of the current frame
+//Returns zero once the frame's events are used up
+static int fake_input_poll(uint16_t* mouse_x, uint16_t* mouse_y, uint8_t* buttons) {
+
+    uint32_t tail = fo_input_tail;
+    fo_input_event event, next_event;
+    int found = 0;
+
+    while(tail != fo_input_frame_end) {
+
+        event = fo_input_ring[tail & (FO_INPUT_RING_SIZE - 1)];
+        tail++;
+        found = 1;
+
+        //Button transitions always get delivered
+        if(event.buttons != fo_input_buttons)
+            break;
+
+        //The last event of the frame always gets delivered
+        if(tail == fo_input_frame_end)
+            break;
+
+        next_event = fo_input_ring[tail & (FO_INPUT_RING_SIZE - 1)];
+
+        //A later motion with the same buttons supersedes this one
+        if(next_event.buttons == event.buttons) {
+
+            found = 0;
+            continue;
+        }
+
+        //Hovering motion right before a press doesn't do anything the
+        //press itself won't. But motion with a button held can be a drag,
+        //which has to land before the release does
+        if(!event.buttons) {
+
+            found = 0;
+            continue;
+        }
+
+        break;
+    }
+
+    //Hand the used-up slots back to the producer
+    __atomic_store_n(&fo_input_tail, tail, __ATOMIC_RELEASE);
+
+    if(!found)
+        return 0;
+
+    fo_input_buttons = event.buttons;
+    *mouse_x = event.mouse_x;
+    *mouse_y = event.mouse_y;
+    *buttons = event.buttons;
+
+    return 1;
+}
+
+#endif //FAKE_INPUT_H
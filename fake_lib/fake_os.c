@@ -1,70 +1,308 @@
 #include "fake_os.h"
+#include "fake_input.h"
+#include "fake_pixel.h"
 #include <emscripten.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
 mouse_handler installed_mouse_callback = (mouse_handler)0;
+frame_handler installed_frame_callback = (frame_handler)0;
+int input_mode = FO_INPUT_IMMEDIATE;
+int mouse_attached = 0;
+unsigned long presented_bytes = 0;
+int presented = 0; //Set once the program presents for itself
+fo_pixel* fo_framebuffer = (fo_pixel*)0;
+uint32_t* fo_canvas_buffer = (uint32_t*)0; //What the canvas gets copied from, in ABGR
+
+//The swap chain, if there is one (see fake_os_createSwapChain)
+fo_pixel* fo_swap_buffers[FO_MAX_SWAP_BUFFERS];
+unsigned long fo_swap_shown[FO_MAX_SWAP_BUFFERS]; //The flip each buffer was last shown by, zero if never
+int fo_swap_count = 0;
+int fo_swap_front = -1; //The one on screen
+int fo_swap_back = -1; //The one handed out to be drawn into
+unsigned long fo_swap_flips = 0;
+
+//Create the output canvas, insert it into the document and show the
+//(already cleared) framebuffer on it once. The canvas can take ABGR pixels
+//as they are, but anything else has to be converted into a buffer of its
+//own on the way out. Zero on failure
+int fake_os_createCanvas(fo_pixel* buffer) {
+
+#if FO_PIXEL_FORMAT == FO_PIXEL_ABGR8888
+    fo_canvas_buffer = buffer;
+#else
+    int i;
+
+    if(!(fo_canvas_buffer = (uint32_t*)malloc(sizeof(uint32_t) * FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT)))
+        return 0;
+
+    for(i = 0; i < FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT; i++)
+        fo_canvas_buffer[i] = 0xFF000000; //The canvas *does* care about the opacity being set, which is annoying
+#endif
+
+    //(EM_ASM allows us to embed JS into our C)
+    EM_ASM_({
+        
+        //Create and store canvas and information
+        window.fo_canvas = document.createElement('canvas');
+        document.body.style.margin = '0px';
+        window.fo_canvas.style.cursor = 'none';
+        window.fo_canvas.width = $0;
+        window.fo_canvas.height = $1;
+        document.body.appendChild(window.fo_canvas);
+        window.fo_context = window.fo_canvas.getContext('2d');
+        window.fo_canvas_data = window.fo_context.getImageData(0, 0, $0, $1);
+
+        //Show the cleared buffer once to start off with
+        window.fo_canvas_data.data.set(
+            Module.HEAPU8.subarray($2, $2 + (4 * $0 * $1))
+        ); 
+        window.fo_context.putImageData(window.fo_canvas_data, 0, 0);
+    }, FO_SCREEN_WIDTH, FO_SCREEN_HEIGHT, fo_canvas_buffer);
+
+    return 1;
+}
 
 //Returns the pointer to the buffer in the return value and the width and the height
 //in the supplied pointers
-uint32_t* fake_os_getActiveVesaBuffer(uint16_t* width, uint16_t* height) {
+fo_pixel* fake_os_getActiveVesaBuffer(uint16_t* width, uint16_t* height) {
 
     //This function will generate a fixed-size canvas and a fixed-size pixel array.
-    //It then clears the buffer and installs a timer function to constantly copy the 
-    //content of the pixel array to the canvas context at 60fps
+    //It then clears the buffer and installs a timer function to keep copying
+    //all of it to the canvas at 60fps. That's what programs that never
+    //present rely on. As soon as the program calls fake_os_present, the
+    //timer stops and the canvas only gets updated in the areas handed to it
     
     //Declare our return variable
-    uint32_t *return_buffer = (uint32_t*)0;
+    fo_pixel *return_buffer = (fo_pixel*)0;
 
     //Clear the dimensions until we've gotten past any potential errors
     *width = 0;
     *height = 0;
 
+    //It's one or the other
+    if(fo_swap_count)
+        return return_buffer;
+
     //Attempt to create the framebuffer array 
-    if(!(return_buffer = (uint32_t*)malloc(sizeof(uint32_t) * FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT)))
+    if(!(return_buffer = (fo_pixel*)malloc(sizeof(fo_pixel) * FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT)))
         return return_buffer; //Exit early indicating error with an empty pointer 
 
+    //Clear the framebuffer to black
+    int i;
+    for(i = 0; i < FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT; i++)
+        return_buffer[i] = fake_pixel_from_color(0xFF000000);
+
+    if(!fake_os_createCanvas(return_buffer)) {
+
+        free(return_buffer);
+        return (fo_pixel*)0;
+    }
+
+    fo_framebuffer = return_buffer;
+
+    //Start refresh handler, which stops itself once presenting takes over
+    EM_ASM(
+        window.fo_refresh_timer = setInterval(function() {
+
+            if(!Module.ccall('fake_os_doRefresh', 'number'))
+                clearInterval(window.fo_refresh_timer);
+        }, 17);
+    );
+
     //Now that we've gotten past the potential error, we'll set the return 
     //screen dimension values
     *width = FO_SCREEN_WIDTH;
     *height = FO_SCREEN_HEIGHT;
 
-    //Clear the framebuffer to black
+    return return_buffer;
+}
+
+//Copy the given parts of a framebuffer to the canvas, converting them to
+//ABGR first if that isn't what the framebuffer holds
+void fake_os_showRects(fo_pixel* buffer, fo_rect* rects, int count) {
+
     int i;
-    for(i = 0; i < (*width) * (*height); i++)
-        return_buffer[i] = 0xFF000000; //The canvas *does* care about the opacity being set, which is annoying
-    
-    //Now we'll create the output canvas and insert it into the document
-    //(EM_ASM allows us to embed JS into our C)
-    //We will also se up the refresh timer here
+    uint32_t* source = (uint32_t*)buffer;
+#if FO_PIXEL_FORMAT != FO_PIXEL_ABGR8888
+    int x, y, offset;
+
+    source = fo_canvas_buffer;
+#endif
+
+    for(i = 0; i < count; i++) {
+
+#if FO_PIXEL_FORMAT != FO_PIXEL_ABGR8888
+        for(y = rects[i].y; y < rects[i].y + rects[i].height; y++) {
+
+            offset = (y * FO_SCREEN_WIDTH) + rects[i].x;
+
+            for(x = 0; x < rects[i].width; x++)
+                fo_canvas_buffer[offset + x] = fake_pixel_to_color(buffer[offset + x]);
+        }
+#endif
+
+        //Copy the rect's rows into the image data, then push only that
+        //part of the image data to the canvas
+        EM_ASM_({
+            var stride = window.fo_canvas.width * 4;
+            var row, start;
+
+            for(row = $1; row < $1 + $3; row++) {
+
+                start = (row * stride) + ($0 * 4);
+                window.fo_canvas_data.data.set(
+                    Module.HEAPU8.subarray($4 + start, $4 + start + ($2 * 4)), start
+                );
+            }
+
+            window.fo_context.putImageData(window.fo_canvas_data, 0, 0, $0, $1, $2, $3);
+        }, rects[i].x, rects[i].y, rects[i].width, rects[i].height, source);
+
+    }
+}
+
+//Keep count of what the program presents
+void fake_os_countPresented(fo_rect* rects, int count) {
+
+    int i;
+
+    for(i = 0; i < count; i++)
+        presented_bytes += sizeof(fo_pixel) * rects[i].width * rects[i].height;
+}
+
+//Called by the refresh timer: copy the whole framebuffer to the canvas,
+//unless the program has started presenting, in which case we return zero
+//so the timer gets stopped
+int EMSCRIPTEN_KEEPALIVE fake_os_doRefresh(void) {
+
+    fo_rect screen_rect;
+
+    if(presented)
+        return 0;
+
+    screen_rect.x = 0;
+    screen_rect.y = 0;
+    screen_rect.width = FO_SCREEN_WIDTH;
+    screen_rect.height = FO_SCREEN_HEIGHT;
+    fake_os_showRects(fo_framebuffer, &screen_rect, 1);
+
+    return 1;
+}
+
+//Copy just the damaged parts of the framebuffer to the canvas
+void fake_os_present(fo_rect* rects, int count) {
+
+    presented = 1;
+    fake_os_showRects(fo_framebuffer, rects, count);
+    fake_os_countPresented(rects, count);
+}
+
+//Set up the buffers and the canvas, all cleared to black
+int fake_os_createSwapChain(int count, uint16_t* width, uint16_t* height) {
+
+    int i, j;
+
+    *width = 0;
+    *height = 0;
+
+    if(count < 2 || count > FO_MAX_SWAP_BUFFERS || fo_swap_count || fo_framebuffer)
+        return 0;
+
+    for(i = 0; i < count; i++) {
+
+        if(!(fo_swap_buffers[i] = (fo_pixel*)malloc(sizeof(fo_pixel) * FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT))) {
+
+            for(j = 0; j < i; j++)
+                free(fo_swap_buffers[j]);
+
+            return 0;
+        }
+
+        for(j = 0; j < FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT; j++)
+            fo_swap_buffers[i][j] = fake_pixel_from_color(0xFF000000);
+
+        fo_swap_shown[i] = 0;
+    }
+
+    if(!fake_os_createCanvas(fo_swap_buffers[0])) {
+
+        for(i = 0; i < count; i++)
+            free(fo_swap_buffers[i]);
+
+        return 0;
+    }
+
+    fo_swap_count = count;
+    *width = FO_SCREEN_WIDTH;
+    *height = FO_SCREEN_HEIGHT;
+
+    return 1;
+}
+
+//Buffers get drawn into in turn, so the one handed out is always the one
+//that has been off screen the longest
+fo_pixel* fake_os_acquireBuffer(int* age) {
+
+    *age = 0;
+
+    if(!fo_swap_count)
+        return (fo_pixel*)0;
+
+    if(fo_swap_back < 0)
+        fo_swap_back = (fo_swap_front + 1) % fo_swap_count;
+
+    if(fo_swap_shown[fo_swap_back])
+        *age = (int)(fo_swap_flips - fo_swap_shown[fo_swap_back]) + 1;
+
+    return fo_swap_buffers[fo_swap_back];
+}
+
+//The canvas can't point at a different buffer, so the flip itself is
+//still a copy, but only of what changed and only out of a buffer that
+//nothing is drawing into any more
+void fake_os_swapBuffers(fo_rect* rects, int count) {
+
+    if(fo_swap_back < 0)
+        return;
+
+    fo_swap_front = fo_swap_back;
+    fo_swap_back = -1;
+    fo_swap_shown[fo_swap_front] = ++fo_swap_flips;
+    fake_os_showRects(fo_swap_buffers[fo_swap_front], rects, count);
+    fake_os_countPresented(rects, count);
+}
+
+unsigned long fake_os_getPresentedBytes(void) {
+
+    return presented_bytes;
+}
+
+//If a trace is being recorded, stash the event in it along with the time
+//(the trace lives on the JS side until it's written out)
+void fake_os_recordEvent(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
     EM_ASM_({
-        
-        //Create and store canvas and information
-        window.fo_canvas = document.createElement('canvas');
-        document.body.style.margin = '0px';
-        window.fo_canvas.style.cursor = 'none';
-        window.fo_canvas.width = $0;
-        window.fo_canvas.height = $1;
-        window.fo_buf_address = $2;
-        window.fo_buf_size = 4 * $0 * $1;
-        document.body.appendChild(window.fo_canvas);
-        window.fo_context = window.fo_canvas.getContext('2d');
-        window.fo_canvas_data = window.fo_context.getImageData(0, 0, $0, $1);
+        if(window.fo_trace)
+            window.fo_trace.push(performance.now(), $0, $1, $2);
+    }, mouse_x, mouse_y, buttons);
+}
 
-        //Start refresh handler
-        setInterval(function() {
+//Start of a frame: hand the queued events to the program
+void fake_os_runFrame(void) {
 
-            //Create an unsigned byte subarray  
-            window.fo_canvas_data.data.set(
-                Module.HEAPU8.subarray(
-                    window.fo_buf_address, window.fo_buf_address + window.fo_buf_size
-                )
-            ); 
-            window.fo_context.putImageData(window.fo_canvas_data, 0, 0);
-        }, 17);
-    }, FO_SCREEN_WIDTH, FO_SCREEN_HEIGHT, return_buffer);
+    uint16_t mouse_x, mouse_y;
+    uint8_t buttons;
 
-    return return_buffer;
+    fake_input_begin_frame();
+
+    //Callback-style programs get the events pushed to them
+    if(installed_mouse_callback)
+        while(fake_input_poll(&mouse_x, &mouse_y, &buttons))
+            installed_mouse_callback(mouse_x, mouse_y, buttons);
+
+    if(installed_frame_callback)
+        installed_frame_callback();
 }
 
 void EMSCRIPTEN_KEEPALIVE fake_os_doMouseCallback(void) {
@@ -72,7 +310,7 @@ void EMSCRIPTEN_KEEPALIVE fake_os_doMouseCallback(void) {
     uint16_t mouse_x, mouse_y;
     uint8_t buttons;
 
-    if(!installed_mouse_callback)
+    if(!installed_mouse_callback && !installed_frame_callback)
         return;
 
     //A mouse event has happened, so get the updated info 
@@ -88,11 +326,16 @@ void EMSCRIPTEN_KEEPALIVE fake_os_doMouseCallback(void) {
         return window.fo_button_status;
     }, 0);
 
-    //Fire callback
-    installed_mouse_callback(mouse_x, mouse_y, buttons);
+    fake_os_pushMouseEvent(mouse_x, mouse_y, buttons);
 }
 
-void fake_os_installMouseCallback(mouse_handler new_handler) {
+//Hook the DOM mouse events up to our callback (only once)
+void fake_os_attachMouse(void) {
+
+    if(mouse_attached)
+        return;
+
+    mouse_attached = 1;
 
     //This is literally just here so that the function 
     //doesn't get optimized out
@@ -121,6 +364,105 @@ void fake_os_installMouseCallback(mouse_handler new_handler) {
             Module.ccall('fake_os_doMouseCallback');
         };
     );
+}
+
+void fake_os_installMouseCallback(mouse_handler new_handler) {
 
+    fake_os_attachMouse();
     installed_mouse_callback = new_handler;
-}
\ No newline at end of file
+}
+
+void fake_os_installFrameCallback(frame_handler new_handler) {
+
+    fake_os_attachMouse();
+    installed_frame_callback = new_handler;
+}
+
+void fake_os_setInputMode(int mode) {
+
+    input_mode = mode;
+}
+
+int fake_os_pollMouseEvent(uint16_t* mouse_x, uint16_t* mouse_y, uint8_t* buttons) {
+
+    return fake_input_poll(mouse_x, mouse_y, buttons);
+}
+
+//The browser's event loop is the one in charge, so all we need to do is make
+//sure frames get run on every animation frame if we're pacing input, and then
+//let main() fall through and keep the runtime alive
+int fake_os_runMainLoop(void) {
+
+    if(input_mode == FO_INPUT_FRAME_PACED)
+        emscripten_set_main_loop(fake_os_runFrame, 0, 0);
+
+    return FO_LOOP_RUNNING;
+}
+
+//Queue up an event the same way the DOM listeners do
+void fake_os_pushMouseEvent(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
+    fake_os_recordEvent(mouse_x, mouse_y, buttons);
+    fake_input_enqueue(mouse_x, mouse_y, buttons);
+
+    if(input_mode == FO_INPUT_IMMEDIATE)
+        fake_os_runFrame();
+}
+
+//There's no disk to write to in here, so just report failure
+int fake_os_dumpFrame(char* path) {
+
+    return 0;
+}
+
+//Begin collecting a trace. The browser can't write files for us, so we
+//just remember what to call the download
+int fake_os_startRecording(char* path) {
+
+    EM_ASM_({
+        window.fo_trace = [];
+        window.fo_trace_name = UTF8ToString($0);
+    }, path);
+
+    return 1;
+}
+
+//Pack the collected events into the binary trace format and offer it up
+//as a download
+void fake_os_stopRecording(void) {
+
+    EM_ASM_({
+        if(!window.fo_trace)
+            return;
+
+        var trace = window.fo_trace;
+        var count = trace.length / 4;
+        var view = new DataView(new ArrayBuffer($0 + (count * $1)));
+        var last_time = count ? trace[0] : 0;
+        var offset = $0;
+        var i, link;
+
+        view.setUint8(0, 0x46); //'F'
+        view.setUint8(1, 0x4F); //'O'
+        view.setUint8(2, 0x54); //'T'
+        view.setUint8(3, 0x52); //'R'
+        view.setUint16(4, $2, true);
+        view.setUint16(6, 0, true);
+
+        for(i = 0; i < count; i++) {
+
+            view.setUint32(offset, Math.round((trace[i * 4] - last_time) * 1000), true);
+            view.setUint16(offset + 4, trace[(i * 4) + 1], true);
+            view.setUint16(offset + 6, trace[(i * 4) + 2], true);
+            view.setUint8(offset + 8, trace[(i * 4) + 3]);
+            last_time = trace[i * 4];
+            offset += $1;
+        }
+
+        link = document.createElement('a');
+        link.href = URL.createObjectURL(new Blob([view.buffer]));
+        link.download = window.fo_trace_name;
+        link.click();
+        window.fo_trace = null;
+    }, FO_TRACE_HEADER_SIZE, FO_TRACE_RECORD_SIZE, FO_TRACE_VERSION);
+}
@@ -1,16 +1,139 @@
 #ifndef FAKE_OS_H
+#define FAKE_OS_H
 
 #include <inttypes.h>
 
-//Used to dimension the canvas and the framebuffer array 
+//Used to dimension the canvas and the framebuffer array
 #define FO_SCREEN_WIDTH  1024
 #define FO_SCREEN_HEIGHT 768
 
+//Framebuffer pixel formats. Like a real video mode, the framebuffer's
+//format is fixed for the whole program, and gets picked when it's built by
+//defining FO_PIXEL_FORMAT as one of these (ABGR8888 if it isn't defined).
+//Whatever it is, pixels only get turned back into colors on their way out
+//to the canvas (or into a dumped frame), see fake_pixel.h
+#define FO_PIXEL_ABGR8888 0 //32 bits, red in the low byte, then green, blue and alpha
+#define FO_PIXEL_XRGB8888 1 //32 bits, blue in the low byte, then green and red, top byte unused
+#define FO_PIXEL_RGB565   2 //16 bits, five of red at the top, six of green and five of blue
+#define FO_PIXEL_PAL8     3 //8 bits, an index into a fixed palette with three bits of red
+                            //at the top, three of green and two of blue
+
+#ifndef FO_PIXEL_FORMAT
+#define FO_PIXEL_FORMAT FO_PIXEL_ABGR8888
+#endif
+
+//One pixel of the framebuffer
+#if FO_PIXEL_FORMAT == FO_PIXEL_RGB565
+typedef uint16_t fo_pixel;
+#define FO_PIXEL_BYTES 2
+#elif FO_PIXEL_FORMAT == FO_PIXEL_PAL8
+typedef uint8_t fo_pixel;
+#define FO_PIXEL_BYTES 1
+#else
+typedef uint32_t fo_pixel;
+#define FO_PIXEL_BYTES 4
+#endif
+
 //Mouse handler callback function pointer type
 typedef void (*mouse_handler)(uint16_t, uint16_t, uint8_t);
 
+//Called once per display frame
+typedef void (*frame_handler)(void);
+
+//How input reaches the program:
+//IMMEDIATE runs a frame for every single event as soon as it arrives.
+//FRAME_PACED queues events up and runs one frame per display refresh, with
+//the queued motion coalesced so that a frame handles at most one motion
+//(plus every button change)
+#define FO_INPUT_IMMEDIATE   0
+#define FO_INPUT_FRAME_PACED 1
+
+//A region of the screen, used to tell the OS what needs to be shown
+typedef struct fo_rect_struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+} fo_rect;
+
 //Exposed functions
-uint32_t* fake_os_getActiveVesaBuffer(uint16_t* width, uint16_t* height);
+fo_pixel* fake_os_getActiveVesaBuffer(uint16_t* width, uint16_t* height);
 void fake_os_installMouseCallback(mouse_handler new_handler);
 
+//Input modes and frames. Each frame, any installed mouse handler gets
+//called with that frame's events, then the frame handler runs. A frame
+//handler can instead pull the frame's events itself with
+//fake_os_pollMouseEvent, which returns zero when there are none left
+void fake_os_setInputMode(int mode);
+void fake_os_installFrameCallback(frame_handler new_handler);
+int fake_os_pollMouseEvent(uint16_t* mouse_x, uint16_t* mouse_y, uint8_t* buttons);
+
+//Until a program first presents, the whole framebuffer gets copied to the
+//screen on a timer, so programs that never present still show up. After
+//that, nothing drawn into the framebuffer reaches the screen until it's
+//presented. Only the listed rectangles are copied out, and presenting
+//nothing costs nothing
+void fake_os_present(fo_rect* rects, int count);
+
+//Swap chains: instead of the one framebuffer from fake_os_getActiveVesaBuffer
+//(use one or the other, not both), a program can ask for two or three of
+//them and draw each frame into one that isn't on screen before flipping to
+//it, so nothing ever gets drawn into what's being shown. Every buffer comes
+//with an age: zero if it has never been on screen, so there's no telling
+//what's in it, otherwise how many flips ago it last was, one being the
+//frame on screen now. A buffer of age n is only missing what changed over
+//the last n - 1 frames
+#define FO_MAX_SWAP_BUFFERS 3
+
+//Set up count buffers the size of the screen. Zero on failure
+int fake_os_createSwapChain(int count, uint16_t* width, uint16_t* height);
+
+//The buffer to draw the next frame into, along with its age. Asking again
+//before the next flip hands back the same buffer
+fo_pixel* fake_os_acquireBuffer(int* age);
+
+//Put the acquired buffer on screen. Like fake_os_present, the rects are
+//what changed since the last frame and only they get copied out
+void fake_os_swapBuffers(fo_rect* rects, int count);
+
+//Running total of framebuffer bytes copied to the screen by fake_os_present
+//or fake_os_swapBuffers
+unsigned long fake_os_getPresentedBytes(void);
+
+//Hands control over to the OS until it runs out of events to deliver, and
+//returns the program's exit code. In the browser the page drives everything,
+//so this returns FO_LOOP_RUNNING right away and events keep coming after
+//main() returns. The native backend pulls events from its synthetic source
+//here instead
+#define FO_LOOP_RUNNING -1
+int fake_os_runMainLoop(void);
+
+//Inject a mouse event as if it came from the mouse device. In immediate
+//mode it's handled before this returns, otherwise it waits for the next frame
+void fake_os_pushMouseEvent(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons);
+
+//Write the current contents of the screen out to a PPM image
+//Returns zero on failure
+int fake_os_dumpFrame(char* path);
+
+//Input traces: every event pushed into the input queue can be captured
+//into a compact binary file and later replayed by the native backend.
+//Events are recorded as they arrive, before frame pacing coalesces any
+//motion, so a trace always holds the full input. The browser times them by
+//the clock. The native backend times the events it plays back itself by
+//their place in the script, so re-recording a replay stores the gaps of the
+//original trace rather than how long each event took to handle
+//The file is an 8-byte header ('F', 'O', 'T', 'R', then a little-endian
+//uint16 version and a reserved uint16) followed by one 9-byte record per
+//event: uint32 microseconds since the previous event, uint16 x, uint16 y
+//and uint8 buttons, all little-endian
+#define FO_TRACE_VERSION 1
+#define FO_TRACE_HEADER_SIZE 8
+#define FO_TRACE_RECORD_SIZE 9
+
+//Start capturing pushed events to the given file (in the browser, the
+//file is offered as a download when recording stops). Zero on failure
+int fake_os_startRecording(char* path);
+void fake_os_stopRecording(void);
+
 #endif //FAKE_OS_H
@@ -0,0 +1,700 @@
+#include "fake_os.h"
+#include "fake_input.h"
+#include "fake_pixel.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+//================| Native Headless Backend |================//
+
+//This is a drop-in replacement for fake_os.c that builds with a plain host
+//compiler. Instead of a canvas we keep the framebuffer in process memory (plus
+//a second 'scanout' copy standing in for the screen, which only changes when
+//damage gets presented or flipped to, in the same pixel format as the
+//framebuffer the way video memory would be), and instead of DOM events we
+//pull mouse events from a synthetic event source:
+//
+//  FO_EVENTS=<file>     Read events from a text file, one 'x y buttons' per line
+//                       ('#' starts a comment). Without it, a built-in demo
+//                       session is played back instead
+//  FO_REPLAY=<file>     Replay a binary trace captured with fake_os_startRecording
+//  FO_REPLAY_SPEED=realtime
+//                       Honour the recorded gaps between events instead of
+//                       delivering them as fast as possible
+//  FO_RECORD=<file>     Capture every pushed event into a binary trace, timed
+//                       by the script (so re-recording a replay keeps its gaps)
+//  FO_INPUT=immediate|paced
+//                       Override the input mode the program asked for. Paced
+//                       frames are cut every 16.667ms of event time
+//  FO_DUMP=<prefix>     Write the final frame to <prefix>-final.ppm
+//  FO_DUMP_EVERY=<n>    Also write <prefix>-<event number>.ppm every n events
+//  FO_CHECK_SWAPS=1     With a swap chain, check every buffer that gets flipped
+//                       to against what a single framebuffer would have put on
+//                       the screen, and report the ones that don't match
+
+//A single synthetic mouse event
+typedef struct fo_event_struct {
+    uint32_t delay_us; //Time since the previous event
+    uint16_t mouse_x;
+    uint16_t mouse_y;
+    uint8_t buttons;
+} fo_event;
+
+//Length of a display frame when pacing input
+#define FO_FRAME_US 16667
+
+mouse_handler installed_mouse_callback = (mouse_handler)0;
+frame_handler installed_frame_callback = (frame_handler)0;
+int fo_input_mode = FO_INPUT_IMMEDIATE;
+fo_pixel* fo_screen_buffer = (fo_pixel*)0;
+fo_pixel* fo_scanout_buffer = (fo_pixel*)0;
+uint16_t fo_screen_width = 0;
+uint16_t fo_screen_height = 0;
+
+//The swap chain, if there is one (see fake_os_createSwapChain)
+fo_pixel* fo_swap_buffers[FO_MAX_SWAP_BUFFERS];
+unsigned long fo_swap_shown[FO_MAX_SWAP_BUFFERS]; //The flip each buffer was last shown by, zero if never
+int fo_swap_count = 0;
+int fo_swap_front = -1; //The one on screen
+int fo_swap_back = -1; //The one handed out to be drawn into
+unsigned long fo_swap_flips = 0;
+int fo_check_swaps = 0; //Set from FO_CHECK_SWAPS
+unsigned long fo_swap_mismatches = 0;
+
+//The loaded event script
+fo_event* fo_events = (fo_event*)0;
+unsigned int fo_event_count = 0;
+unsigned int fo_event_capacity = 0;
+
+//Running totals for the benchmark report
+unsigned long fo_queued_count = 0;
+unsigned long fo_delivered_count = 0;
+unsigned long fo_frame_count = 0;
+double fo_frame_ms = 0.0;
+unsigned long fo_present_count = 0;
+unsigned long fo_idle_present_count = 0;
+unsigned long fo_presented_bytes = 0;
+
+//The trace we're currently recording into, if any
+FILE* fo_trace_file = (FILE*)0;
+double fo_trace_last_ms = 0.0;
+
+//The script time of the event being pushed by the main loop, or negative if
+//the program pushed it itself (which is timed by the clock instead)
+double fo_script_time_ms = -1.0;
+
+//Monotonic wall clock in milliseconds
+double fake_os_now_ms(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+//A screen-sized buffer cleared to black, same as the browser version
+fo_pixel* fake_os_new_buffer(void) {
+
+    int i;
+    fo_pixel* buffer;
+
+    if(!(buffer = (fo_pixel*)malloc(sizeof(fo_pixel) * FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT)))
+        return buffer;
+
+    for(i = 0; i < FO_SCREEN_WIDTH * FO_SCREEN_HEIGHT; i++)
+        buffer[i] = fake_pixel_from_color(0xFF000000);
+
+    return buffer;
+}
+
+//Returns the pointer to the buffer in the return value and the width and the height
+//in the supplied pointers
+fo_pixel* fake_os_getActiveVesaBuffer(uint16_t* width, uint16_t* height) {
+
+    //Clear the dimensions until we've gotten past any potential errors
+    *width = 0;
+    *height = 0;
+
+    //It's either this or a swap chain
+    if(fo_swap_count)
+        return (fo_pixel*)0;
+
+    //We only have the one screen, so hand back the same one if asked twice
+    if(!fo_screen_buffer) {
+
+        if(!(fo_screen_buffer = fake_os_new_buffer()))
+            return fo_screen_buffer;
+
+        if(!(fo_scanout_buffer = fake_os_new_buffer())) {
+
+            free(fo_screen_buffer);
+            fo_screen_buffer = (fo_pixel*)0;
+            return fo_screen_buffer;
+        }
+
+        fo_screen_width = FO_SCREEN_WIDTH;
+        fo_screen_height = FO_SCREEN_HEIGHT;
+    }
+
+    *width = fo_screen_width;
+    *height = fo_screen_height;
+
+    return fo_screen_buffer;
+}
+
+void fake_os_installMouseCallback(mouse_handler new_handler) {
+
+    installed_mouse_callback = new_handler;
+}
+
+void fake_os_installFrameCallback(frame_handler new_handler) {
+
+    installed_frame_callback = new_handler;
+}
+
+//FO_INPUT trumps whatever the program asked for
+void fake_os_setInputMode(int mode) {
+
+    char* forced_mode = getenv("FO_INPUT");
+
+    if(forced_mode)
+        mode = strcmp(forced_mode, "paced") ? FO_INPUT_IMMEDIATE : FO_INPUT_FRAME_PACED;
+
+    fo_input_mode = mode;
+}
+
+int fake_os_pollMouseEvent(uint16_t* mouse_x, uint16_t* mouse_y, uint8_t* buttons) {
+
+    if(!fake_input_poll(mouse_x, mouse_y, buttons))
+        return 0;
+
+    fo_delivered_count++;
+
+    return 1;
+}
+
+//Hand the queued events to the program, timing how long it takes
+void fake_os_runFrame(void) {
+
+    uint16_t mouse_x, mouse_y;
+    uint8_t buttons;
+    double start_ms = fake_os_now_ms();
+
+    fake_input_begin_frame();
+
+    //Callback-style programs get the events pushed to them
+    if(installed_mouse_callback)
+        while(fake_os_pollMouseEvent(&mouse_x, &mouse_y, &buttons))
+            installed_mouse_callback(mouse_x, mouse_y, buttons);
+
+    if(installed_frame_callback)
+        installed_frame_callback();
+
+    fo_frame_ms += fake_os_now_ms() - start_ms;
+    fo_frame_count++;
+}
+
+//Copy the damaged rectangles from a framebuffer to the 'screen', keeping
+//count of how much we had to move
+void fake_os_show_rects(fo_pixel* buffer, fo_rect* rects, int count) {
+
+    int i, y;
+    uint32_t offset;
+
+    fo_present_count++;
+
+    if(!count)
+        fo_idle_present_count++;
+
+    for(i = 0; i < count; i++) {
+
+        for(y = rects[i].y; y < rects[i].y + rects[i].height; y++) {
+
+            offset = (y * fo_screen_width) + rects[i].x;
+            memcpy(fo_scanout_buffer + offset, buffer + offset,
+                   sizeof(fo_pixel) * rects[i].width);
+        }
+
+        fo_presented_bytes += sizeof(fo_pixel) * rects[i].width * rects[i].height;
+    }
+}
+
+void fake_os_present(fo_rect* rects, int count) {
+
+    fake_os_show_rects(fo_screen_buffer, rects, count);
+}
+
+//The scanout copy doubles as the framebuffer a single-buffered program
+//would have, since it's built up out of exactly the damage that would have
+//been presented. A buffer that's just been flipped to has to match it
+//everywhere, or whatever brought the buffer up to date missed something
+//(which would show up on a screen that really flips between buffers)
+void fake_os_check_swap(void) {
+
+    int i;
+    fo_pixel* buffer = fo_swap_buffers[fo_swap_front];
+
+    if(!memcmp(buffer, fo_scanout_buffer, sizeof(fo_pixel) * fo_screen_width * fo_screen_height))
+        return;
+
+    for(i = 0; buffer[i] == fo_scanout_buffer[i]; i++);
+
+    fprintf(stderr, "fake_os: flip %lu doesn't match a single framebuffer, first at %d, %d\n",
+            fo_swap_flips, i % fo_screen_width, i / fo_screen_width);
+    fo_swap_mismatches++;
+}
+
+int fake_os_createSwapChain(int count, uint16_t* width, uint16_t* height) {
+
+    int i;
+
+    *width = 0;
+    *height = 0;
+
+    if(count < 2 || count > FO_MAX_SWAP_BUFFERS || fo_swap_count || fo_screen_buffer)
+        return 0;
+
+    if(!(fo_scanout_buffer = fake_os_new_buffer()))
+        return 0;
+
+    for(i = 0; i < count; i++) {
+
+        if(!(fo_swap_buffers[i] = fake_os_new_buffer())) {
+
+            while(i--)
+                free(fo_swap_buffers[i]);
+
+            free(fo_scanout_buffer);
+            fo_scanout_buffer = (fo_pixel*)0;
+            return 0;
+        }
+
+        fo_swap_shown[i] = 0;
+    }
+
+    fo_swap_count = count;
+    fo_check_swaps = getenv("FO_CHECK_SWAPS") != (char*)0;
+    fo_screen_width = FO_SCREEN_WIDTH;
+    fo_screen_height = FO_SCREEN_HEIGHT;
+    *width = fo_screen_width;
+    *height = fo_screen_height;
+
+    return 1;
+}
+
+//Buffers get drawn into in turn, so the one handed out is always the one
+//that has been off screen the longest
+fo_pixel* fake_os_acquireBuffer(int* age) {
+
+    *age = 0;
+
+    if(!fo_swap_count)
+        return (fo_pixel*)0;
+
+    if(fo_swap_back < 0)
+        fo_swap_back = (fo_swap_front + 1) % fo_swap_count;
+
+    if(fo_swap_shown[fo_swap_back])
+        *age = (int)(fo_swap_flips - fo_swap_shown[fo_swap_back]) + 1;
+
+    return fo_swap_buffers[fo_swap_back];
+}
+
+//A real flip would just point the display at the other buffer. Ours still
+//copies the damage to the 'screen', the same way the browser version has
+//to copy it to the canvas, so that the two keep counting the same bytes
+void fake_os_swapBuffers(fo_rect* rects, int count) {
+
+    if(fo_swap_back < 0)
+        return;
+
+    fo_swap_front = fo_swap_back;
+    fo_swap_back = -1;
+    fo_swap_shown[fo_swap_front] = ++fo_swap_flips;
+    fake_os_show_rects(fo_swap_buffers[fo_swap_front], rects, count);
+
+    if(fo_check_swaps)
+        fake_os_check_swap();
+}
+
+unsigned long fake_os_getPresentedBytes(void) {
+
+    return fo_presented_bytes;
+}
+
+//Write a little-endian value of the given number of bytes to a file
+void fake_os_write_le(FILE* out_file, uint32_t value, int bytes) {
+
+    for(; bytes; bytes--, value >>= 8)
+        fputc(value & 0xFF, out_file);
+}
+
+//Read a little-endian value of the given number of bytes from a buffer
+uint32_t fake_os_read_le(uint8_t* buffer, int bytes) {
+
+    uint32_t value = 0;
+
+    while(bytes--)
+        value = (value << 8) | buffer[bytes];
+
+    return value;
+}
+
+int fake_os_startRecording(char* path) {
+
+    fake_os_stopRecording();
+
+    if(!(fo_trace_file = fopen(path, "wb")))
+        return 0;
+
+    fputc('F', fo_trace_file);
+    fputc('O', fo_trace_file);
+    fputc('T', fo_trace_file);
+    fputc('R', fo_trace_file);
+    fake_os_write_le(fo_trace_file, FO_TRACE_VERSION, 2);
+    fake_os_write_le(fo_trace_file, 0, 2);
+    fo_trace_last_ms = -1.0;
+
+    return 1;
+}
+
+void fake_os_stopRecording(void) {
+
+    if(!fo_trace_file)
+        return;
+
+    fclose(fo_trace_file);
+    fo_trace_file = (FILE*)0;
+}
+
+//Append an event to the trace being recorded, if there is one
+void fake_os_recordEvent(double time_ms, uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
+    if(!fo_trace_file)
+        return;
+
+    //The first event of a recording has no predecessor to be relative to
+    if(fo_trace_last_ms < 0.0)
+        fo_trace_last_ms = time_ms;
+
+    fake_os_write_le(fo_trace_file, (uint32_t)((time_ms - fo_trace_last_ms) * 1000.0), 4);
+    fake_os_write_le(fo_trace_file, mouse_x, 2);
+    fake_os_write_le(fo_trace_file, mouse_y, 2);
+    fake_os_write_le(fo_trace_file, buttons, 1);
+    fo_trace_last_ms = time_ms;
+}
+
+//Queue an event up, and handle it right away if we're not pacing input
+void fake_os_pushMouseEvent(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
+    fake_os_recordEvent(fo_script_time_ms < 0.0 ? fake_os_now_ms() : fo_script_time_ms,
+                        mouse_x, mouse_y, buttons);
+    fake_input_enqueue(mouse_x, mouse_y, buttons);
+    fo_queued_count++;
+
+    if(fo_input_mode == FO_INPUT_IMMEDIATE)
+        fake_os_runFrame();
+}
+
+//Write what's on the 'screen' out as a binary PPM, whatever format its
+//pixels are in, by way of their ABGR colors
+int fake_os_dumpFrame(char* path) {
+
+    FILE* out_file;
+    int i;
+    uint32_t pixel;
+    uint8_t rgb[3];
+    fo_pixel* frame = fo_scanout_buffer;
+
+    //Like the browser's refresh timer, programs that never present get
+    //their whole framebuffer shown
+    if(!fo_present_count && fo_screen_buffer)
+        frame = fo_screen_buffer;
+
+    if(!frame)
+        return 0;
+
+    if(!(out_file = fopen(path, "wb")))
+        return 0;
+
+    fprintf(out_file, "P6\n%d %d\n255\n", fo_screen_width, fo_screen_height);
+
+    for(i = 0; i < fo_screen_width * fo_screen_height; i++) {
+
+        pixel = fake_pixel_to_color(frame[i]);
+        rgb[0] = pixel & 0xFF;
+        rgb[1] = (pixel >> 8) & 0xFF;
+        rgb[2] = (pixel >> 16) & 0xFF;
+        fwrite(rgb, 1, 3, out_file);
+    }
+
+    fclose(out_file);
+
+    return 1;
+}
+
+//Append an event to the script, growing it as needed
+int fake_os_add_timed_event(uint32_t delay_us, uint16_t mouse_x,
+                            uint16_t mouse_y, uint8_t buttons) {
+
+    fo_event* new_events;
+
+    if(fo_event_count == fo_event_capacity) {
+
+        fo_event_capacity = fo_event_capacity ? fo_event_capacity * 2 : 256;
+
+        if(!(new_events = (fo_event*)realloc(fo_events, sizeof(fo_event) * fo_event_capacity)))
+            return 0;
+
+        fo_events = new_events;
+    }
+
+    fo_events[fo_event_count].delay_us = delay_us;
+    fo_events[fo_event_count].mouse_x = mouse_x;
+    fo_events[fo_event_count].mouse_y = mouse_y;
+    fo_events[fo_event_count].buttons = buttons;
+    fo_event_count++;
+
+    return 1;
+}
+
+//Scripted events don't carry timing information, so we space them out
+//like a typical 125Hz mouse would
+int fake_os_add_event(uint16_t mouse_x, uint16_t mouse_y, uint8_t buttons) {
+
+    return fake_os_add_timed_event(8000, mouse_x, mouse_y, buttons);
+}
+
+//Move the mouse in a straight line from one point to another
+void fake_os_add_stroke(int x1, int y1, int x2, int y2, int steps, uint8_t buttons) {
+
+    int i;
+
+    for(i = 1; i <= steps; i++)
+        fake_os_add_event(x1 + ((x2 - x1) * i) / steps,
+                          y1 + ((y2 - y1) * i) / steps, buttons);
+}
+
+//Press and release at a point
+void fake_os_add_click(int x, int y) {
+
+    fake_os_add_event(x, y, 0);
+    fake_os_add_event(x, y, 1);
+    fake_os_add_event(x, y, 0);
+}
+
+//A small, deterministic session that exercises the same paths a person
+//would: spawning calculators, dragging them around and pressing buttons
+void fake_os_build_demo_script(void) {
+
+    int i;
+
+    fake_os_add_stroke(512, 384, 60, 25, 32, 0);
+
+    for(i = 0; i < 4; i++) {
+
+        //Spawn a calculator (it appears at the origin on top of the launcher)
+        fake_os_add_click(60, 25);
+
+        //Drag it out of the way by its titlebar
+        fake_os_add_event(60, 15, 1);
+        fake_os_add_stroke(60, 15, 260 + (i * 120), 120 + (i * 60), 48, 1);
+        fake_os_add_event(260 + (i * 120), 120 + (i * 60), 0);
+
+        //Punch a few of its keys
+        fake_os_add_click(200 + (i * 120) + 25, 105 + (i * 60) + 65);
+        fake_os_add_click(200 + (i * 120) + 60, 105 + (i * 60) + 100);
+        fake_os_add_click(200 + (i * 120) + 95, 105 + (i * 60) + 135);
+
+        fake_os_add_stroke(260 + (i * 120), 120 + (i * 60), 60, 25, 32, 0);
+    }
+
+    //Wander across the whole stack
+    fake_os_add_stroke(60, 25, 1000, 700, 128, 0);
+}
+
+//Load an event script from a text file
+int fake_os_load_script(char* path) {
+
+    FILE* in_file;
+    char line[256];
+    int mouse_x, mouse_y, buttons;
+
+    if(!(in_file = fopen(path, "r")))
+        return 0;
+
+    while(fgets(line, sizeof(line), in_file)) {
+
+        if(line[0] == '#')
+            continue;
+
+        if(sscanf(line, "%d %d %d", &mouse_x, &mouse_y, &buttons) == 3)
+            fake_os_add_event(mouse_x, mouse_y, buttons);
+    }
+
+    fclose(in_file);
+
+    return 1;
+}
+
+//Load a binary trace recorded by either backend
+int fake_os_load_trace(char* path) {
+
+    FILE* in_file;
+    uint8_t record[FO_TRACE_RECORD_SIZE];
+
+    if(!(in_file = fopen(path, "rb")))
+        return 0;
+
+    //Check the header before trusting anything else in the file
+    if(fread(record, 1, FO_TRACE_HEADER_SIZE, in_file) != FO_TRACE_HEADER_SIZE ||
+       record[0] != 'F' || record[1] != 'O' || record[2] != 'T' || record[3] != 'R' ||
+       fake_os_read_le(record + 4, 2) != FO_TRACE_VERSION) {
+
+        fclose(in_file);
+        return 0;
+    }
+
+    while(fread(record, 1, FO_TRACE_RECORD_SIZE, in_file) == FO_TRACE_RECORD_SIZE)
+        fake_os_add_timed_event(fake_os_read_le(record, 4),
+                                fake_os_read_le(record + 4, 2),
+                                fake_os_read_le(record + 6, 2),
+                                record[8]);
+
+    fclose(in_file);
+
+    return 1;
+}
+
+//Sleep until the given point on the fake_os_now_ms() clock
+void fake_os_sleep_until(double target_ms) {
+
+    struct timespec delay;
+    double remaining_ms = target_ms - fake_os_now_ms();
+
+    if(remaining_ms <= 0.0)
+        return;
+
+    delay.tv_sec = (time_t)(remaining_ms / 1000.0);
+    delay.tv_nsec = (long)((remaining_ms - (delay.tv_sec * 1000.0)) * 1000000.0);
+    nanosleep(&delay, (struct timespec*)0);
+}
+
+//Play the synthetic event source into the installed handler, then report
+int fake_os_runMainLoop(void) {
+
+    char* script_path = getenv("FO_EVENTS");
+    char* replay_path = getenv("FO_REPLAY");
+    char* replay_speed = getenv("FO_REPLAY_SPEED");
+    char* record_path = getenv("FO_RECORD");
+    int realtime = replay_speed && !strcmp(replay_speed, "realtime");
+    double start_ms;
+    uint64_t event_time_us = 0;
+    uint64_t frame_end_us = FO_FRAME_US;
+    char* dump_prefix = getenv("FO_DUMP");
+    char* dump_every_string = getenv("FO_DUMP_EVERY");
+    unsigned int dump_every = dump_every_string ? atoi(dump_every_string) : 0;
+    char dump_path[512];
+    unsigned int i;
+
+    if(replay_path) {
+
+        if(!fake_os_load_trace(replay_path)) {
+
+            fprintf(stderr, "fake_os: could not read trace '%s'\n", replay_path);
+            return 1;
+        }
+    } else if(script_path) {
+
+        if(!fake_os_load_script(script_path)) {
+
+            fprintf(stderr, "fake_os: could not read event script '%s'\n", script_path);
+            return 1;
+        }
+    } else {
+
+        fake_os_build_demo_script();
+    }
+
+    if(record_path && !fake_os_startRecording(record_path))
+        fprintf(stderr, "fake_os: could not record to '%s'\n", record_path);
+
+    //Apply any FO_INPUT override even if the program never picked a mode
+    fake_os_setInputMode(fo_input_mode);
+
+    start_ms = fake_os_now_ms();
+
+    for(i = 0; i < fo_event_count; i++) {
+
+        event_time_us += fo_events[i].delay_us;
+
+        //When pacing, run a frame for every frame boundary that this
+        //event's timestamp has gone past
+        while(fo_input_mode == FO_INPUT_FRAME_PACED && event_time_us >= frame_end_us) {
+
+            //Flat out, there's no point in running frames with nothing in them
+            if(!realtime && fo_input_head == fo_input_tail) {
+
+                frame_end_us = event_time_us - (event_time_us % FO_FRAME_US) + FO_FRAME_US;
+                break;
+            }
+
+            if(realtime)
+                fake_os_sleep_until(start_ms + (frame_end_us / 1000.0));
+
+            fake_os_runFrame();
+            frame_end_us += FO_FRAME_US;
+        }
+
+        //In real time mode we wait out the recorded gap first
+        if(realtime)
+            fake_os_sleep_until(start_ms + (event_time_us / 1000.0));
+
+        fo_script_time_ms = event_time_us / 1000.0;
+        fake_os_pushMouseEvent(fo_events[i].mouse_x, fo_events[i].mouse_y, fo_events[i].buttons);
+        fo_script_time_ms = -1.0;
+
+        if(dump_prefix && dump_every && !((i + 1) % dump_every)) {
+
+            snprintf(dump_path, sizeof(dump_path), "%s-%06u.ppm", dump_prefix, i + 1);
+            fake_os_dumpFrame(dump_path);
+        }
+    }
+
+    //Whatever is left over makes up the last frame
+    if(fo_input_mode == FO_INPUT_FRAME_PACED)
+        fake_os_runFrame();
+
+    fake_os_stopRecording();
+
+    if(dump_prefix) {
+
+        snprintf(dump_path, sizeof(dump_path), "%s-final.ppm", dump_prefix);
+        fake_os_dumpFrame(dump_path);
+    }
+
+    fprintf(stderr, "fake_os: %lu events in %.3f ms (%.4f ms/event, %.0f events/s)\n",
+            fo_delivered_count, fo_frame_ms,
+            fo_delivered_count ? fo_frame_ms / fo_delivered_count : 0.0,
+            fo_frame_ms > 0.0 ? (fo_delivered_count * 1000.0) / fo_frame_ms : 0.0);
+
+    fprintf(stderr, "fake_os: %lu events queued, %lu delivered over %lu frames (%.4f ms/frame)\n",
+            fo_queued_count, fo_delivered_count, fo_frame_count,
+            fo_frame_count ? fo_frame_ms / fo_frame_count : 0.0);
+
+    fprintf(stderr, "fake_os: %lu bytes presented over %lu frames (%.0f bytes/frame, %lu idle)\n",
+            fo_presented_bytes, fo_present_count,
+            fo_present_count ? (double)fo_presented_bytes / fo_present_count : 0.0,
+            fo_idle_present_count);
+
+    if(fo_check_swaps)
+        fprintf(stderr, "fake_os: %lu of %lu flips didn't match a single framebuffer\n",
+                fo_swap_mismatches, fo_swap_flips);
+
+    free(fo_events);
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef FAKE_PIXEL_H
+#define FAKE_PIXEL_H
+
+#include <inttypes.h>
+#include "fake_os.h"
+
+//================| Pixel Conversion |================//
+
+//Going between colors and pixels of the framebuffer's format (see
+//FO_PIXEL_FORMAT in fake_os.h). Colors are always ABGR words, the same as
+//the ABGR8888 format, which is also what the canvas takes. Like
+//fake_input.h, this lives entirely in a header so that every chapter's
+//build script keeps working.
+//
+//The formats with fewer bits just drop the low bits of each channel, and
+//going back the other way repeats the bits that are left to fill the
+//channel out again, so white stays white and black stays black
+
+//The pixel closest to a color
+static inline fo_pixel fake_pixel_from_color(uint32_t color) {
+
+#if FO_PIXEL_FORMAT == FO_PIXEL_XRGB8888
+    return (fo_pixel)(((color & 0xFF) << 16) | (color & 0xFF00FF00) | ((color >> 16) & 0xFF));
+#elif FO_PIXEL_FORMAT == FO_PIXEL_RGB565
+    return (fo_pixel)(((color & 0xF8) << 8) | ((color >> 5) & 0x7E0) | ((color >> 19) & 0x1F));
+#elif FO_PIXEL_FORMAT == FO_PIXEL_PAL8
+    return (fo_pixel)((color & 0xE0) | ((color >> 11) & 0x1C) | ((color >> 22) & 0x03));
+#else
+    return (fo_pixel)color;
+#endif
+}
+
+//The color a pixel stands for, fully opaque for the formats without alpha
+static inline uint32_t fake_pixel_to_color(fo_pixel pixel) {
+
+#if FO_PIXEL_FORMAT == FO_PIXEL_XRGB8888
+    return ((pixel & 0xFF) << 16) | (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF);
+#elif FO_PIXEL_FORMAT == FO_PIXEL_RGB565
+    uint32_t red = (pixel >> 11) & 0x1F;
+    uint32_t green = (pixel >> 5) & 0x3F;
+    uint32_t blue = pixel & 0x1F;
+
+    return 0xFF000000 | (((blue << 3) | (blue >> 2)) << 16) |
+           (((green << 2) | (green >> 4)) << 8) | ((red << 3) | (red >> 2));
+#elif FO_PIXEL_FORMAT == FO_PIXEL_PAL8
+    uint32_t red = (pixel >> 5) & 0x7;
+    uint32_t green = (pixel >> 2) & 0x7;
+    uint32_t blue = pixel & 0x3;
+
+    return 0xFF000000 | ((blue * 0x55) << 16) |
+           (((green << 5) | (green << 2) | (green >> 1)) << 8) |
+           ((red << 5) | (red << 2) | (red >> 1));
+#else
+    return pixel;
+#endif
+}
+
+#endif //FAKE_PIXEL_H